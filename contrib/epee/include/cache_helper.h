@@ -135,19 +135,31 @@ namespace epee
       }
     };
 
+    struct i_isolation_reader_check
+    {
+      // false if calling thread reads data which cache may not match (older db snapshot, for example)
+      virtual bool is_cache_allowed_for_reader() const = 0;
+    };
+
     class isolation_lock
     {
     private: 
       critical_section m_my_lock;
       critical_section& m_lock;
       boost::optional<std::thread::id> m_current_writer_thread;
+      const i_isolation_reader_check* m_preader_check;
     public:
-      isolation_lock() :m_lock(m_my_lock)
+      isolation_lock() :m_lock(m_my_lock), m_preader_check(nullptr)
       {}
 
-      isolation_lock(critical_section& lock) :m_lock(lock)
+      isolation_lock(critical_section& lock) :m_lock(lock), m_preader_check(nullptr)
       {}
 
+      void set_reader_check(const i_isolation_reader_check* preader_check)
+      {
+        m_preader_check = preader_check;
+      }
+
       template<typename res_type, typename callback_t>
       res_type isolated_access(callback_t cb) const 
       {
@@ -161,6 +173,8 @@ namespace epee
             return cb(false);
           }
         }
+        if (m_preader_check && !m_preader_check->is_cache_allowed_for_reader())
+          return cb(false);
         //cache shared(allowed)
         return cb(true);
       }
@@ -32,6 +32,9 @@
 
 #include <list>
 #include <numeric>
+#include <atomic>
+#include <cmath>
+#include <algorithm>
 #include <boost/timer/timer.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/random_generator.hpp>
@@ -126,6 +129,131 @@ namespace math_helper
 		mutable critical_section m_lock;
 	};
 
+  /************************************************************************/
+  /* log-linear (HDR-like) histogram, 3 significant bits per power of two */
+  /* push() is lock-free, so it's cheap enough to sit on hot paths        */
+  /************************************************************************/
+  class latency_histogram
+  {
+  public:
+    enum
+    {
+      exact_values_count = 16,            // values below this land in their own bucket
+      sub_buckets_per_magnitude = 8,
+      buckets_count = exact_values_count + (64 - 4) * sub_buckets_per_magnitude
+    };
+
+    latency_histogram()
+    {
+      reset();
+    }
+
+    void push(uint64_t v)
+    {
+      m_buckets[get_bucket_index(v)].fetch_add(1, std::memory_order_relaxed);
+      m_count.fetch_add(1, std::memory_order_relaxed);
+      m_sum.fetch_add(v, std::memory_order_relaxed);
+      uint64_t prev_max = m_max.load(std::memory_order_relaxed);
+      while (v > prev_max && !m_max.compare_exchange_weak(prev_max, v, std::memory_order_relaxed));
+    }
+
+    uint64_t get_count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t get_sum() const { return m_sum.load(std::memory_order_relaxed); }
+    uint64_t get_max() const { return m_max.load(std::memory_order_relaxed); }
+
+    // returns upper bound of the bucket holding requested quantile (0 < q <= 1), clamped by max
+    uint64_t get_percentile(double q) const
+    {
+      uint64_t total = 0;
+      uint64_t snapshot[buckets_count];
+      for (size_t i = 0; i != buckets_count; i++)
+      {
+        snapshot[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += snapshot[i];
+      }
+      if (!total)
+        return 0;
+
+      uint64_t rank = static_cast<uint64_t>(std::ceil(q * total));
+      if (rank < 1)
+        rank = 1;
+      uint64_t max_val = get_max();
+      uint64_t acc = 0;
+      for (size_t i = 0; i != buckets_count; i++)
+      {
+        acc += snapshot[i];
+        if (acc >= rank)
+          return (std::min)(get_bucket_upper_bound(i), max_val);
+      }
+      return max_val;
+    }
+
+    void reset()
+    {
+      for (size_t i = 0; i != buckets_count; i++)
+        m_buckets[i].store(0, std::memory_order_relaxed);
+      m_count.store(0, std::memory_order_relaxed);
+      m_sum.store(0, std::memory_order_relaxed);
+      m_max.store(0, std::memory_order_relaxed);
+    }
+
+    static size_t get_bucket_index(uint64_t v)
+    {
+      if (v < exact_values_count)
+        return static_cast<size_t>(v);
+
+      size_t msb = 0;
+      for (uint64_t t = v; t >>= 1;)
+        msb++;
+      //msb >= 4 here, keep 4 upper bits (leading one + 3 bits of mantissa)
+      size_t top = static_cast<size_t>(v >> (msb - 3));
+      return exact_values_count + (msb - 4) * sub_buckets_per_magnitude + (top - sub_buckets_per_magnitude);
+    }
+
+    static uint64_t get_bucket_upper_bound(size_t index)
+    {
+      if (index < exact_values_count)
+        return index;
+
+      size_t msb = (index - exact_values_count) / sub_buckets_per_magnitude + 4;
+      uint64_t top = (index - exact_values_count) % sub_buckets_per_magnitude + sub_buckets_per_magnitude;
+      return (((top + 1) << (msb - 3)) - 1);
+    }
+
+  private:
+    std::atomic<uint64_t> m_buckets[buckets_count];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+  };
+
+  /************************************************************************/
+  /* drop-in replacement for average<> that also keeps full distribution  */
+  /************************************************************************/
+  template<typename val, int default_base>
+  class average_with_histogram : public average<val, default_base>
+  {
+  public:
+    typedef val value_type;
+
+    void push(const value_type& vl)
+    {
+      average<val, default_base>::push(vl);
+      m_histogram.push(static_cast<uint64_t>(vl));
+    }
+
+    const latency_histogram& get_histogram() const { return m_histogram; }
+
+    void reset()
+    {
+      average<val, default_base>::reset();
+      m_histogram.reset();
+    }
+
+  private:
+    latency_histogram m_histogram;
+  };
+
 	
 #ifdef WINDOWS_PLATFORM
 	
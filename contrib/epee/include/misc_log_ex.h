@@ -41,6 +41,12 @@
 #include <list>
 #include <map>
 #include <set>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
 #include <time.h>
 #ifndef Q_MOC_RUN
 #include <boost/cstdint.hpp>
@@ -88,6 +94,8 @@ DISABLE_VS_WARNINGS(4100)
 #define   LOGGER_DUMP       4
 
 #define LOG_JOURNAL_MAX_ELEMENTS 100
+#define LOG_ASYNC_RING_DEFAULT_CAPACITY   4096
+#define LOG_ASYNC_FLUSH_INTERVAL_MS       20
 
 #ifdef _DEBUG 
   #define _ASSERTE__(expr)   if(!expr) {__debugbreak();}
@@ -884,9 +892,8 @@ namespace log_space
 
     bool do_log_message(const std::string& rlog_mes, int log_level, int color, const char* plog_name = NULL)
     {
-      std::string str_mess = rlog_mes;
-      size_t str_len = str_mess.size();
-      const char* pstr = str_mess.c_str();
+      size_t str_len = rlog_mes.size();
+      const char* pstr = rlog_mes.c_str();
       for(streams_container::iterator it = m_log_streams.begin(); it!=m_log_streams.end();it++)
         if(it->second >= log_level)
           it->first->out_buffer(pstr, (int)str_len, log_level, color, plog_name);
@@ -956,6 +963,78 @@ namespace log_space
         std::string m_default_log_file_path;
   };
 
+  /************************************************************************/
+  /* Bounded single-producer/single-consumer ring used by async logging:  */
+  /* the owning thread pushes formatted messages without locking, the     */
+  /* writer thread drains it. When the ring is full the message is        */
+  /* dropped and accounted by the caller.                                 */
+  /************************************************************************/
+  class async_log_ring
+  {
+  public:
+    struct entry
+    {
+      std::string message;
+      int log_level;
+      int color;
+      const char* plog_name;
+    };
+
+    async_log_ring(size_t capacity) : m_entries(capacity ? capacity : 1), m_head(0), m_tail(0)
+    {}
+
+    bool push(const std::string& message, int log_level, int color, const char* plog_name)
+    {
+      uint64_t head = m_head.load(std::memory_order_relaxed);
+      if (head - m_tail.load(std::memory_order_acquire) >= m_entries.size())
+        return false;
+      entry& e = m_entries[head % m_entries.size()];
+      e.message.assign(message); // slot keeps its capacity, so no allocation once warmed up
+      e.log_level = log_level;
+      e.color = color;
+      e.plog_name = plog_name;
+      m_head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    template<class t_cb>
+    size_t pop_all(t_cb cb)
+    {
+      uint64_t tail = m_tail.load(std::memory_order_relaxed);
+      uint64_t head = m_head.load(std::memory_order_acquire);
+      size_t count = 0;
+      for (; tail != head; ++tail, ++count)
+      {
+        cb(m_entries[tail % m_entries.size()]);
+        m_tail.store(tail + 1, std::memory_order_release);
+      }
+      return count;
+    }
+
+    size_t size() const
+    {
+      return static_cast<size_t>(m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire));
+    }
+
+    size_t capacity() const
+    {
+      return m_entries.size();
+    }
+
+  private:
+    std::vector<entry> m_entries;
+    std::atomic<uint64_t> m_head;
+    std::atomic<uint64_t> m_tail;
+  };
+
+  struct async_log_stats
+  {
+    uint64_t written;
+    uint64_t dropped;
+    uint64_t threads;
+    bool enabled;
+  };
+
   /************************************************************************/
   /*                                                                      */
   /************************************************************************/
@@ -1027,14 +1106,18 @@ namespace log_space
   public:
     friend class log_singletone;
 
-    logger()
+    logger() : m_async_enabled(false), m_async_stop(false), m_async_ring_capacity(LOG_ASYNC_RING_DEFAULT_CAPACITY),
+      m_async_written(0), m_async_dropped(0), m_async_dropped_reported(0)
     {
+      static std::atomic<uint64_t> instances_counter(0);
+      m_instance_id = ++instances_counter;
       FAST_CRITICAL_REGION_BEGIN(m_critical_sec);
       init();
       FAST_CRITICAL_REGION_END();
     }
     ~logger()
     {
+      disable_async_mode();
     }
 
     bool set_max_logfile_size(uint64_t max_size)
@@ -1089,6 +1172,14 @@ namespace log_space
     }
     bool do_log_message(const std::string& rlog_mes, int log_level, int color, bool add_to_journal = false, const char* plog_name = NULL)
     {
+      if (m_async_enabled.load(std::memory_order_relaxed))
+      {
+        //journal messages (errors) are written in place, right after everything queued before them
+        if (!add_to_journal)
+          return push_async_message(rlog_mes, log_level, color, plog_name);
+        drain_async_rings();
+      }
+
       FAST_CRITICAL_REGION_BEGIN(m_critical_sec);
       m_log_target.do_log_message(rlog_mes, log_level, color, plog_name);
       if (add_to_journal)
@@ -1156,8 +1247,133 @@ namespace log_space
       return m_log_target.get_log_file_path();
     }
 
+    bool enable_async_mode(size_t ring_capacity)
+    {
+      std::lock_guard<std::mutex> lk(m_async_control_lock);
+      if (m_async_enabled)
+        return true;
+      m_async_ring_capacity = ring_capacity;
+      m_async_stop = false;
+      m_async_writer = std::thread([this]() { async_writer_thread(); });
+      m_async_enabled = true;
+      return true;
+    }
+
+    bool disable_async_mode()
+    {
+      std::lock_guard<std::mutex> lk(m_async_control_lock);
+      if (!m_async_enabled)
+        return true;
+      m_async_enabled = false;
+      {
+        std::lock_guard<std::mutex> wk(m_async_wakeup_lock);
+        m_async_stop = true;
+      }
+      m_async_wakeup.notify_one();
+      if (m_async_writer.joinable())
+        m_async_writer.join();
+      //flush whatever was pushed by threads which raced with disabling
+      drain_async_rings();
+      return true;
+    }
+
+    async_log_stats get_async_stats()
+    {
+      async_log_stats st = { 0, 0, 0, false };
+      st.written = m_async_written;
+      st.dropped = m_async_dropped;
+      st.enabled = m_async_enabled;
+      FAST_CRITICAL_REGION_LOCAL(m_async_rings_lock);
+      st.threads = m_async_rings.size();
+      return st;
+    }
+
+    bool flush_async()
+    {
+      drain_async_rings();
+      return true;
+    }
+
   protected:
   private:
+    struct async_thread_slot
+    {
+      uint64_t owner_id;
+      std::shared_ptr<async_log_ring> ring;
+    };
+
+    static async_thread_slot& get_async_thread_slot()
+    {
+      static thread_local async_thread_slot slot = { 0, std::shared_ptr<async_log_ring>() };
+      return slot;
+    }
+
+    bool push_async_message(const std::string& rlog_mes, int log_level, int color, const char* plog_name)
+    {
+      async_thread_slot& slot = get_async_thread_slot();
+      if (slot.owner_id != m_instance_id || !slot.ring)
+      {
+        //first message from this thread: register its own ring, the only place where lock is taken
+        slot.ring = std::make_shared<async_log_ring>(m_async_ring_capacity);
+        slot.owner_id = m_instance_id;
+        FAST_CRITICAL_REGION_LOCAL(m_async_rings_lock);
+        m_async_rings.push_back(slot.ring);
+      }
+
+      if (!slot.ring->push(rlog_mes, log_level, color, plog_name))
+      {
+        ++m_async_dropped;
+        m_async_wakeup.notify_one();
+        return false;
+      }
+      if (slot.ring->size() == slot.ring->capacity() / 2)
+        m_async_wakeup.notify_one();
+      return true;
+    }
+
+    size_t drain_async_rings()
+    {
+      FAST_CRITICAL_REGION_LOCAL(m_critical_sec);
+      size_t count = 0;
+      {
+        FAST_CRITICAL_REGION_LOCAL_VAR(m_async_rings_lock, rings_region);
+        for (auto it = m_async_rings.begin(); it != m_async_rings.end();)
+        {
+          count += (*it)->pop_all([&](const async_log_ring::entry& e) {
+            m_log_target.do_log_message(e.message, e.log_level, e.color, e.plog_name);
+          });
+          //ring is referenced only from here, so its thread has exited and nothing will be pushed anymore
+          if ((*it).use_count() == 1 && !(*it)->size())
+            it = m_async_rings.erase(it);
+          else
+            ++it;
+        }
+      }
+      m_async_written += count;
+
+      uint64_t dropped = m_async_dropped;
+      if (dropped != m_async_dropped_reported)
+      {
+        std::stringstream ss;
+        ss << get_time_string() << " [async log] " << dropped - m_async_dropped_reported << " messages dropped due to overflow, " << dropped << " in total" << std::endl;
+        m_log_target.do_log_message(ss.str(), LOG_LEVEL_0, console_color_yellow);
+        m_async_dropped_reported = dropped;
+      }
+      return count;
+    }
+
+    void async_writer_thread()
+    {
+      std::unique_lock<std::mutex> lk(m_async_wakeup_lock);
+      while (!m_async_stop)
+      {
+        m_async_wakeup.wait_for(lk, std::chrono::milliseconds(LOG_ASYNC_FLUSH_INTERVAL_MS));
+        lk.unlock();
+        drain_async_rings();
+        lk.lock();
+      }
+    }
+
     bool init()
     {
       //
@@ -1208,6 +1424,21 @@ namespace log_space
     std::list<std::string> m_journal;
     size_t m_journal_max_elements;
     critical_section m_critical_sec;
+
+    //async mode
+    uint64_t m_instance_id;
+    std::atomic<bool> m_async_enabled;
+    bool m_async_stop;
+    size_t m_async_ring_capacity;
+    std::atomic<uint64_t> m_async_written;
+    std::atomic<uint64_t> m_async_dropped;
+    uint64_t m_async_dropped_reported;
+    std::list<std::shared_ptr<async_log_ring> > m_async_rings;
+    critical_section m_async_rings_lock;
+    std::thread m_async_writer;
+    std::mutex m_async_control_lock;
+    std::mutex m_async_wakeup_lock;
+    std::condition_variable m_async_wakeup;
   };
   /************************************************************************/
   /*                                                                      */
@@ -1320,6 +1551,39 @@ namespace log_space
       return res;
     }
 
+    //moves file/console output to a background thread, log lines are queued into per-thread rings
+    static bool enable_async_mode(size_t ring_capacity = LOG_ASYNC_RING_DEFAULT_CAPACITY)
+    {
+      logger* plogger = get_or_create_instance();
+      if (!plogger) return false;
+      return plogger->enable_async_mode(ring_capacity);
+    }
+
+    static bool disable_async_mode()
+    {
+      logger* plogger = get_or_create_instance();
+      if (!plogger) return false;
+      return plogger->disable_async_mode();
+    }
+
+    static bool flush_async()
+    {
+      logger* plogger = get_or_create_instance();
+      if (!plogger) return false;
+      return plogger->flush_async();
+    }
+
+    static async_log_stats get_async_stats()
+    {
+      logger* plogger = get_or_create_instance();
+      if (!plogger)
+      {
+        async_log_stats st = { 0, 0, 0, false };
+        return st;
+      }
+      return plogger->get_async_stats();
+    }
+
     static bool take_away_journal(std::list<std::string>& journal)
     {
       logger* plogger = get_or_create_instance();
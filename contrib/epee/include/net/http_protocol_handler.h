@@ -48,9 +48,11 @@ namespace net_utils
 		/************************************************************************/
 		struct http_server_config
 		{
+      http_server_config():m_compress_min_body_size(0){}
       void on_send_stop_signal(){}
 			std::string m_folder;
 			critical_section m_lock;
+			size_t m_compress_min_body_size; //responses this big or bigger are gzip/deflate encoded if the client accepts it, 0 - never
 		};
 
 		/************************************************************************/
@@ -114,6 +116,8 @@ namespace net_utils
 			bool analize_cached_request_header_and_invoke_state(size_t pos);
 
 			bool handle_invoke_query_line();
+			bool is_keep_alive(const http::http_request_info& query_info);
+			void compress_response_body(const http::http_request_info& query_info, http_response_info& response);
 			bool parse_cached_header(http_header_info& body_info, const std::string& m_cache_to_process, size_t pos);
 			std::string::size_type match_end_of_header(const std::string& buf);
 			bool get_len_from_content_lenght(const std::string& str, size_t& len);
@@ -122,7 +126,7 @@ namespace net_utils
 			bool set_ready_state();
 			bool slash_to_back_slash(std::string& str);
 			std::string get_file_mime_tipe(const std::string& path);
-			std::string get_response_header(const http_response_info& response);
+			std::string get_response_header(const http_request_info& query_info, const http_response_info& response);
 
 			//major function 
 			inline bool handle_request_and_send_response(const http::http_request_info& query_info);
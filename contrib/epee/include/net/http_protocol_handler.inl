@@ -32,6 +32,7 @@
 #include "string_tools.h"
 #include "file_io_utils.h"
 #include "net_parse_helpers.h"
+#include "zlib_helper.h"
 
 #define HTTP_MAX_URI_LEN	              	 9000 
 #define HTTP_MAX_PRE_COMMAND_LINE_CHARS		 20 
@@ -195,6 +196,135 @@ namespace net_utils
 
 
 
+		//--------------------------------------------------------------------------------------------
+		inline bool is_http_space(char c)
+		{
+			return c == ' ' || c == '\t';
+		}
+		//--------------------------------------------------------------------------------------------
+		inline void trim_http_value(const char*& begin, const char*& end)
+		{
+			while(begin != end && is_http_space(*begin))
+				++begin;
+			while(end != begin && (is_http_space(end[-1]) || end[-1] == '\r'))
+				--end;
+		}
+		//--------------------------------------------------------------------------------------------
+		inline bool parse_http_version_number(const char*& p, const char* end, int& number)
+		{
+			const char* begin = p;
+			number = 0;
+			for(; p != end && *p >= '0' && *p <= '9' && p - begin < 4; ++p)
+				number = number * 10 + (*p - '0');
+			return p != begin;
+		}
+		//--------------------------------------------------------------------------------------------
+		// "<METHOD> <URI> HTTP/<major>.<minor>", the line is given without '\n'
+		inline bool parse_http_request_line(const char* begin, const char* end, http::http_request_info& query_info)
+		{
+			static const struct { const char* name; http::http_method method; } methods[] = {
+				{"GET", http::http_method_get}, {"POST", http::http_method_post}, {"HEAD", http::http_method_head}, {"PUT", http::http_method_put},
+				{"OPTIONS", http::http_method_etc}, {"DELETE", http::http_method_etc}, {"TRACE", http::http_method_etc}
+			};
+			if(end != begin && end[-1] == '\r')
+				--end;
+
+			const char* method_end = std::find(begin, end, ' ');
+			const char* uri_begin = method_end == end ? end : method_end + 1;
+			const char* uri_end = std::find(uri_begin, end, ' ');
+			if(uri_end == end || uri_end == uri_begin)
+				return false;
+
+			std::string method_str(begin, method_end);
+			bool method_found = false;
+			for(size_t i = 0; i != sizeof(methods) / sizeof(methods[0]) && !method_found; i++)
+			{
+				if(!string_tools::compare_no_case(method_str, methods[i].name))
+				{
+					query_info.m_http_method = methods[i].method;
+					method_found = true;
+				}
+			}
+			if(!method_found)
+				return false;
+
+			const char* p = uri_end + 1;
+			static const char http_prefix[] = "HTTP/";
+			const size_t http_prefix_len = sizeof(http_prefix) - 1;
+			if(static_cast<size_t>(end - p) < http_prefix_len || string_tools::compare_no_case(std::string(p, p + http_prefix_len), http_prefix))
+				return false;
+			p += http_prefix_len;
+			if(!parse_http_version_number(p, end, query_info.m_http_ver_hi) || p == end || *p != '.')
+				return false;
+			++p;
+			if(!parse_http_version_number(p, end, query_info.m_http_ver_lo) || p != end)
+				return false;
+
+			query_info.m_http_method_str.swap(method_str);
+			query_info.m_URI.assign(uri_begin, uri_end);
+			return true;
+		}
+		//--------------------------------------------------------------------------------------------
+		inline std::string* get_well_known_header_field(http_header_info& info, const std::string& name)
+		{
+			static const struct { const char* name; std::string http_header_info::* pfield; } fields[] = {
+				{"Connection", &http_header_info::m_connection},
+				{"Referer", &http_header_info::m_referer},
+				{"Content-Length", &http_header_info::m_content_length},
+				{"Content-Type", &http_header_info::m_content_type},
+				{"Transfer-Encoding", &http_header_info::m_transfer_encoding},
+				{"Content-Encoding", &http_header_info::m_content_encoding},
+				{"Host", &http_header_info::m_host},
+				{"Cookie", &http_header_info::m_cookie}
+			};
+			for(size_t i = 0; i != sizeof(fields) / sizeof(fields[0]); i++)
+			{
+				if(!string_tools::compare_no_case(name, fields[i].name))
+					return &(info.*fields[i].pfield);
+			}
+			return nullptr;
+		}
+		//--------------------------------------------------------------------------------------------
+		// checks comma separated list like "Connection: keep-alive, Upgrade" for the token, parameters after ';' are ignored
+		inline bool http_list_has_token(const std::string& value, const char* token, bool* pzero_quality = nullptr)
+		{
+			size_t pos = 0;
+			while(pos < value.size())
+			{
+				size_t item_end = value.find(',', pos);
+				if(std::string::npos == item_end)
+					item_end = value.size();
+				size_t name_end = std::min(value.find(';', pos), item_end);
+				std::string name = string_tools::trim(value.substr(pos, name_end - pos));
+				if(!string_tools::compare_no_case(name, token))
+				{
+					if(pzero_quality)
+					{
+						//"gzip;q=0" means gzip is not acceptable
+						std::string params = value.substr(name_end, item_end - name_end);
+						params.erase(std::remove_if(params.begin(), params.end(), is_http_space), params.end());
+						size_t q_pos = params.find("q=");
+						if(std::string::npos == q_pos)
+							q_pos = params.find("Q=");
+						*pzero_quality = std::string::npos != q_pos && std::string::npos == params.find_first_not_of("0.", q_pos + 2);
+					}
+					return true;
+				}
+				pos = item_end + 1;
+			}
+			return false;
+		}
+		//--------------------------------------------------------------------------------------------
+		inline bool is_content_coding_acceptable(const std::string& accept_encoding, const char* coding)
+		{
+			bool zero_quality = false;
+			if(http_list_has_token(accept_encoding, coding, &zero_quality))
+				return !zero_quality;
+			if(http_list_has_token(accept_encoding, "*", &zero_quality))
+				return !zero_quality;
+			return false;
+		}
+
 		//--------------------------------------------------------------------------------------------
 		template<class t_connection_context>
 		simple_http_connection_handler<t_connection_context>::simple_http_connection_handler(i_service_endpoint* psnd_hndlr, config_type& config):
@@ -246,7 +376,7 @@ namespace net_utils
 			m_cache.swap(buf);
 
 		m_is_stop_handling = false;
-		while(!m_is_stop_handling)
+		while(!m_is_stop_handling && !m_want_close)
 		{
 			switch(m_state)
 			{
@@ -274,7 +404,10 @@ namespace net_utils
 					break;
 				}
 				if(std::string::npos != m_cache.find('\n', 0))
-					handle_invoke_query_line();
+				{
+					if(!handle_invoke_query_line())
+						return false;
+				}
 				else
 				{
 					m_is_stop_handling = true;
@@ -300,11 +433,15 @@ namespace net_utils
 						}	
 						break;
 					}
-					analize_cached_request_header_and_invoke_state(pos);
+					if(!analize_cached_request_header_and_invoke_state(pos))
+						return false;
 					break;
 				}
 			case http_state_retriving_body:
-				return handle_retriving_query_body();
+				//pipelined requests may follow the body in the same buffer
+				if(!handle_retriving_query_body())
+					return false;
+				break;
 			case http_state_connection_close:
 				return false;
 			default:
@@ -321,57 +458,26 @@ namespace net_utils
 
 		return true;
 	}
-	//--------------------------------------------------------------------------------------------
-	inline bool analize_http_method(const boost::smatch& result, http::http_method& method, int& http_ver_major, int& http_ver_minor)
-	{
-		CHECK_AND_ASSERT_MES(result[0].matched, false, "simple_http_connection_handler::analize_http_method() assert failed...");
-		http_ver_major = boost::lexical_cast<int>(result[11]);
-		http_ver_minor = boost::lexical_cast<int>(result[12]);
-		if(result[4].matched)
-			method = http::http_method_get;
-		else if(result[5].matched)
-			method = http::http_method_head;
-		else if(result[6].matched)
-			method = http::http_method_post;
-		else if(result[7].matched)
-			method = http::http_method_put;
-		else 
-			method = http::http_method_etc;
-
-		return true;
-	}
-
   //--------------------------------------------------------------------------------------------
   template<class t_connection_context>
 	bool simple_http_connection_handler<t_connection_context>::handle_invoke_query_line()
 	{ 
 		LOG_FRAME("simple_http_connection_handler<t_connection_context>::handle_invoke_query_line(*)", LOG_LEVEL_3);
 
-		STATIC_REGEXP_EXPR_1(rexp_match_command_line, "^(((OPTIONS)|(GET)|(HEAD)|(POST)|(PUT)|(DELETE)|(TRACE)) (\\S+) HTTP/(\\d+).(\\d+))\r?\n", boost::regex::icase | boost::regex::normal);
-		//											                       123         4     5      6      7     8        9        10          11     12    
-		//size_t match_len = 0;
-		boost::smatch result;	
-		if(boost::regex_search(m_cache, result, rexp_match_command_line, boost::match_default) && result[0].matched)
-		{
-			analize_http_method(result, m_query_info.m_http_method, m_query_info.m_http_ver_hi, m_query_info.m_http_ver_hi);
-			m_query_info.m_URI = result[10];
-      parse_uri(m_query_info.m_URI, m_query_info.m_uri_content);
-			m_query_info.m_http_method_str = result[2];
-			m_query_info.m_full_request_str = result[0];
-
-			m_cache.erase(m_cache.begin(),  to_nonsonst_iterator(m_cache, result[0].second));
-
-			m_state = http_state_retriving_header;
-
-			return true;
-		}else
+		std::string::size_type line_end = m_cache.find('\n');
+		CHECK_AND_ASSERT_MES(std::string::npos != line_end, false, "handle_invoke_query_line() called without complete line");
+		if(!parse_http_request_line(m_cache.data(), m_cache.data() + line_end, m_query_info))
 		{
 			m_state = http_state_error;
-			LOG_ERROR("simple_http_connection_handler<t_connection_context>::handle_invoke_query_line(): Failed to match first line: " << m_cache);
+			LOG_ERROR("simple_http_connection_handler<t_connection_context>::handle_invoke_query_line(): Failed to match first line: " << m_cache.substr(0, line_end));
 			return false;
 		}
+		parse_uri(m_query_info.m_URI, m_query_info.m_uri_content);
+		m_query_info.m_full_request_str.assign(m_cache, 0, line_end + 1);
+		m_cache.erase(0, line_end + 1);
 
-		return false;
+		m_state = http_state_retriving_header;
+		return true;
 	}
 	//--------------------------------------------------------------------------------------------
   template<class t_connection_context>
@@ -379,6 +485,11 @@ namespace net_utils
 	{
 
     //Here we returning head size, including terminating sequence (\r\n\r\n or \n\n)
+		//request line is already taken from buf, so request without fields starts with the empty line
+		if(!buf.compare(0, 2, "\r\n"))
+			return 2;
+		if(!buf.compare(0, 1, "\n"))
+			return 1;
 		std::string::size_type res = buf.find("\r\n\r\n");
 		if(std::string::npos != res)
 			return res+4;
@@ -402,6 +513,7 @@ namespace net_utils
 		{
 			LOG_ERROR("simple_http_connection_handler<t_connection_context>::analize_cached_request_header_and_invoke_state(): failed to anilize request header: " << m_cache);
 			m_state = http_state_error;
+			return false;
 		}
 
 		m_cache.erase(0, pos);
@@ -487,50 +599,57 @@ namespace net_utils
 	{ 
 		LOG_FRAME("http_stream_filter::parse_cached_header(*)", LOG_LEVEL_3);
 
-		STATIC_REGEXP_EXPR_1(rexp_mach_field, 
-			"\n?((Connection)|(Referer)|(Content-Length)|(Content-Type)|(Transfer-Encoding)|(Content-Encoding)|(Host)|(Cookie)"
-			//  12            3         4                5              6                   7                  8      9    
-			"|([\\w-]+?)) ?: ?((.*?)(\r?\n))[^\t ]",	
-			//10             1112   13 
-			boost::regex::icase | boost::regex::normal);
-
-		boost::smatch		result;
-		std::string::const_iterator it_current_bound = m_cache_to_process.begin();
-		std::string::const_iterator it_end_bound = m_cache_to_process.begin()+pos;
+		const char* p = m_cache_to_process.data();
+		const char* end_of_header = p + pos;
+		std::string* plast_value = nullptr;
 
 		body_info.clear();
 
-		//lookup all fields and fill well-known fields
-		while( boost::regex_search( it_current_bound, it_end_bound, result, rexp_mach_field, boost::match_default) && result[0].matched) 
+		//well-known fields are filled, the rest goes to m_etc_fields
+		while(p != end_of_header)
 		{
-			const size_t field_val = 12;
-			const size_t field_etc_name = 10;
-
-			int i = 2; //start position = 2
-			if(result[i++].matched)//"Connection"
-				body_info.m_connection = result[field_val];
-			else if(result[i++].matched)//"Referer"
-				body_info.m_referer = result[field_val];
-			else if(result[i++].matched)//"Content-Length"
-				body_info.m_content_length = result[field_val];
-			else if(result[i++].matched)//"Content-Type"
-				body_info.m_content_type = result[field_val];
-			else if(result[i++].matched)//"Transfer-Encoding"
-				body_info.m_transfer_encoding = result[field_val];
-			else if(result[i++].matched)//"Content-Encoding"
-				body_info.m_content_encoding = result[field_val];
-			else if(result[i++].matched)//"Host"
-				body_info.m_host = result[field_val];
-			else if(result[i++].matched)//"Cookie"
-				body_info.m_cookie = result[field_val];
-			else if(result[i++].matched)//e.t.c (HAVE TO BE MATCHED!)
-				body_info.m_etc_fields.push_back(std::pair<std::string, std::string>(result[field_etc_name], result[field_val]));
-			else
+			const char* line_begin = p;
+			const char* line_end = std::find(line_begin, end_of_header, '\n');
+			p = line_end == end_of_header ? line_end : line_end + 1;
+			if(line_end != line_begin && line_end[-1] == '\r')
+				--line_end;
+			if(line_begin == line_end)
+				break;
+
+			if(is_http_space(*line_begin))
 			{
-				LOG_ERROR("simple_http_connection_handler<t_connection_context>::parse_cached_header() not matched last entry in:"<<m_cache_to_process);
+				//obsolete line folding, continues the previous field
+				trim_http_value(line_begin, line_end);
+				if(plast_value && line_begin != line_end)
+					plast_value->append(1, ' ').append(line_begin, line_end);
+				continue;
 			}
 
-			it_current_bound = result[(int)result.size()-1]. first;
+			const char* colon = std::find(line_begin, line_end, ':');
+			if(colon == line_end)
+			{
+				LOG_PRINT_L2("simple_http_connection_handler<t_connection_context>::parse_cached_header() skipped malformed line: " << std::string(line_begin, line_end));
+				plast_value = nullptr;
+				continue;
+			}
+			const char* name_begin = line_begin;
+			const char* name_end = colon;
+			const char* value_begin = colon + 1;
+			const char* value_end = line_end;
+			trim_http_value(name_begin, name_end);
+			trim_http_value(value_begin, value_end);
+
+			std::string name(name_begin, name_end);
+			plast_value = get_well_known_header_field(body_info, name);
+			if(plast_value)
+			{
+				plast_value->assign(value_begin, value_end);
+			}
+			else
+			{
+				body_info.m_etc_fields.push_back(std::pair<std::string, std::string>(name, std::string(value_begin, value_end)));
+				plast_value = &body_info.m_etc_fields.back().second;
+			}
 		}
 		return  true;
 	}
@@ -538,13 +657,11 @@ namespace net_utils
   template<class t_connection_context>
 	bool simple_http_connection_handler<t_connection_context>::get_len_from_content_lenght(const std::string& str, size_t& OUT len)
 	{
-		STATIC_REGEXP_EXPR_1(rexp_mach_field, "\\d+", boost::regex::normal);
-		std::string res;
-		boost::smatch result;
-		if(!(boost::regex_search( str, result, rexp_mach_field, boost::match_default) && result[0].matched))
+		std::string digits = string_tools::trim(str);
+		if(digits.empty() || digits.size() > 19 || std::string::npos != digits.find_first_not_of("0123456789"))
 			return false;
 
-		len = boost::lexical_cast<size_t>(result[0]);
+		len = boost::lexical_cast<size_t>(digits);
 		return true;
 	}
 	//-----------------------------------------------------------------------------------
@@ -555,17 +672,42 @@ namespace net_utils
 		bool res = handle_request(query_info, response);
 		//CHECK_AND_ASSERT_MES(res, res, "handle_request(query_info, response) returned false" );
 
-		std::string response_data = get_response_header(response);
+		compress_response_body(query_info, response);
+		std::string response_data = get_response_header(query_info, response);
 		
 		//LOG_PRINT_L0("HTTP_SEND: << \r\n" << response_data + response.m_body);
     LOG_PRINT_L3("HTTP_RESPONSE_HEAD: << \r\n" << response_data);
-		
+
+		//one send for head and body, so a persistent connection does not wait for delayed ACK between them
+		response_data.reserve(response_data.size() + response.m_body.size());
+		response_data += response.m_body;
 		m_psnd_hndlr->do_send((void*)response_data.data(), response_data.size());
-		if(response.m_body.size())
-			m_psnd_hndlr->do_send((void*)response.m_body.data(), response.m_body.size());
 		return res;
 	}
 	//-----------------------------------------------------------------------------------
+  template<class t_connection_context>
+	void simple_http_connection_handler<t_connection_context>::compress_response_body(const http::http_request_info& query_info, http_response_info& response)
+	{
+		if(!m_config.m_compress_min_body_size || response.m_body.size() < m_config.m_compress_min_body_size)
+			return;
+		//handler could have encoded the body by itself
+		if(get_value_from_fields_list("Content-Encoding", response.m_additional_fields).size())
+			return;
+
+		response.m_additional_fields.push_back(std::pair<std::string, std::string>("Vary", " Accept-Encoding"));
+		std::string accept_encoding = get_value_from_fields_list("Accept-Encoding", query_info.m_header_info.m_etc_fields);
+		bool gzip = is_content_coding_acceptable(accept_encoding, "gzip");
+		if(!gzip && !is_content_coding_acceptable(accept_encoding, "deflate"))
+			return;
+
+		std::string packed;
+		if(!zlib_helper::pack_http_content(response.m_body, packed, gzip))
+			return; //send it as is
+		LOG_PRINT_L3("HTTP response body " << (gzip ? "gzip" : "deflate") << " encoded: " << response.m_body.size() << " -> " << packed.size());
+		response.m_body.swap(packed);
+		response.m_additional_fields.push_back(std::pair<std::string, std::string>("Content-Encoding", gzip ? " gzip" : " deflate"));
+	}
+	//-----------------------------------------------------------------------------------
   template<class t_connection_context>
 	bool simple_http_connection_handler<t_connection_context>::handle_request(const http::http_request_info& query_info, http_response_info& response)
 	{
@@ -598,7 +740,18 @@ namespace net_utils
 	}
 	//-----------------------------------------------------------------------------------
   template<class t_connection_context>
-	std::string simple_http_connection_handler<t_connection_context>::get_response_header(const http_response_info& response)
+	bool simple_http_connection_handler<t_connection_context>::is_keep_alive(const http::http_request_info& query_info)
+	{
+		//HTTP/1.1 connection is persistent unless client asks to close it, HTTP/1.0 one only if client asks to keep it
+		if(http_list_has_token(query_info.m_header_info.m_connection, "close"))
+			return false;
+		if(query_info.m_http_ver_hi > 1 || (query_info.m_http_ver_hi == 1 && query_info.m_http_ver_lo >= 1))
+			return true;
+		return http_list_has_token(query_info.m_header_info.m_connection, "keep-alive");
+	}
+	//-----------------------------------------------------------------------------------
+  template<class t_connection_context>
+	std::string simple_http_connection_handler<t_connection_context>::get_response_header(const http_request_info& query_info, const http_response_info& response)
 	{
 		std::string buf = "HTTP/1.1 ";
 		buf += boost::lexical_cast<std::string>(response.m_response_code) + " " + response.m_response_comment + "\r\n" +
@@ -615,16 +768,16 @@ namespace net_utils
 		buf += "Accept-Ranges: bytes\r\n";
 		//Wed, 01 Dec 2010 03:27:41 GMT"
 
-		string_tools::trim(m_query_info.m_header_info.m_connection);
-		if(m_query_info.m_header_info.m_connection.size())
+		if(!is_keep_alive(query_info))
 		{
-			if(!string_tools::compare_no_case("close", m_query_info.m_header_info.m_connection))
-			{
-        //closing connection after sending
-				buf += "Connection: close\r\n";
-				m_state = http_state_connection_close;
-				m_want_close = true;
-			}
+      //closing connection after sending
+			buf += "Connection: close\r\n";
+			m_state = http_state_connection_close;
+			m_want_close = true;
+		}
+		else if(query_info.m_http_ver_hi == 1 && query_info.m_http_ver_lo == 0)
+		{
+			buf += "Connection: keep-alive\r\n";
 		}
 		//add additional fields, if it is
 		for(fields_list::const_iterator it = response.m_additional_fields.begin(); it!=response.m_additional_fields.end(); it++)
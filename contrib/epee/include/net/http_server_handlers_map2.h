@@ -26,9 +26,65 @@
 
 
 #pragma once 
+#include <chrono>
+#include <map>
+#include <memory>
 #include "serialization/keyvalue_serialization.h"
 #include "storages/portable_storage_template_helper.h"
 #include "http_base.h"
+#include "math_helper.h"
+#include "syncobj.h"
+
+namespace epee
+{
+  namespace net_utils
+  {
+    namespace http
+    {
+      /************************************************************************/
+      /* latency of every handler served through uri maps, process-wide      */
+      /************************************************************************/
+      class handlers_latency_stats
+      {
+      public:
+        static handlers_latency_stats& instance()
+        {
+          static handlers_latency_stats stats;
+          return stats;
+        }
+
+        math_helper::latency_histogram& get(const std::string& handler_name)
+        {
+          CRITICAL_REGION_LOCAL(m_lock);
+          std::shared_ptr<math_helper::latency_histogram>& ph = m_histograms[handler_name];
+          if (!ph)
+            ph.reset(new math_helper::latency_histogram());
+          return *ph;
+        }
+
+        template<class t_cb>
+        void enumerate(t_cb cb)
+        {
+          CRITICAL_REGION_LOCAL(m_lock);
+          for (auto it = m_histograms.begin(); it != m_histograms.end(); it++)
+            cb(it->first, *it->second);
+        }
+
+      private:
+        critical_section m_lock;
+        std::map<std::string, std::shared_ptr<math_helper::latency_histogram> > m_histograms;
+      };
+    }
+  }
+}
+
+#define HANDLER_LATENCY_START()  std::chrono::high_resolution_clock::time_point handler_latency_start = std::chrono::high_resolution_clock::now();
+// histogram reference is resolved once per handler, so the map lock is not touched on subsequent calls
+#define HANDLER_LATENCY_FINISH(handler_name) \
+  { \
+    static epee::math_helper::latency_histogram& handler_latency_hist = epee::net_utils::http::handlers_latency_stats::instance().get(handler_name); \
+    handler_latency_hist.push(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - handler_latency_start).count()); \
+  }
 
 template<typename request_t, typename response_t>
 bool auto_doc_t(const std::string& prefix_name, std::string& generate_reference)
@@ -75,25 +131,34 @@ bool auto_doc(const std::string& prefix_name, std::string& generate_reference)
 
 #define MAP_URI2(pattern, callback)  else if(std::string::npos != query_info.m_URI.find(pattern)) return callback(query_info, response_info, m_conn_context);
 
+#define MAP_URI_RAW2(s_pattern, callback_f) \
+    else if(query_info.m_URI == s_pattern) \
+    { \
+      call_found = true; \
+      return callback_f(query_info, response_info, m_conn_context); \
+    }
+
 #define MAP_URI_AUTO_XML2(s_pattern, callback_f, command_type) //TODO: don't think i ever again will use xml - ambiguous and "overtagged" format
 
 #define MAP_URI_AUTO_JON2(s_pattern, callback_f, command_type) \
     else if(auto_doc<command_type>(s_pattern "[JSON]", generate_reference) && query_info.m_URI == s_pattern) \
     { \
       call_found = true; \
+      HANDLER_LATENCY_START(); \
       uint64_t ticks = misc_utils::get_tick_count(); \
       boost::value_initialized<command_type::request> req; \
-      bool res = epee::serialization::load_t_from_json(static_cast<command_type::request&>(req), query_info.m_body); \
+      bool res = epee::serialization::load_t_from_json_on_demand(static_cast<command_type::request&>(req), query_info.m_body); \
       CHECK_AND_ASSERT_MES(res, false, "Failed to parse json: \r\n" << query_info.m_body); \
       uint64_t ticks1 = epee::misc_utils::get_tick_count(); \
       boost::value_initialized<command_type::response> resp;\
       res = callback_f(static_cast<command_type::request&>(req), static_cast<command_type::response&>(resp), m_conn_context); \
       CHECK_AND_ASSERT_MES(res, false, "Failed to call " << #callback_f << "() while handling " << s_pattern); \
       uint64_t ticks2 = epee::misc_utils::get_tick_count(); \
-      epee::serialization::store_t_to_json(static_cast<command_type::response&>(resp), response_info.m_body); \
+      epee::serialization::store_t_to_json_stream(static_cast<command_type::response&>(resp), response_info.m_body); \
       uint64_t ticks3 = epee::misc_utils::get_tick_count(); \
       response_info.m_mime_tipe = "application/json"; \
       response_info.m_header_info.m_content_type = " application/json"; \
+      HANDLER_LATENCY_FINISH(s_pattern); \
       LOG_PRINT("[HTTP/JSON][" << epee::string_tools::get_ip_string_from_int32(m_conn_context.m_remote_ip ) << "][" << query_info.m_URI << "] processed with " << ticks1-ticks << "/"<< ticks2-ticks1 << "/" << ticks3-ticks2 << "ms", LOG_LEVEL_2); \
     }
 
@@ -101,6 +166,7 @@ bool auto_doc(const std::string& prefix_name, std::string& generate_reference)
     else if(auto_doc<command_type>(s_pattern "[BIN]", generate_reference) && query_info.m_URI == s_pattern) \
     { \
       call_found = true; \
+      HANDLER_LATENCY_START(); \
       uint64_t ticks = misc_utils::get_tick_count(); \
       boost::value_initialized<command_type::request> req; \
       bool res = epee::serialization::load_t_from_binary(static_cast<command_type::request&>(req), query_info.m_body); \
@@ -114,6 +180,7 @@ bool auto_doc(const std::string& prefix_name, std::string& generate_reference)
       uint64_t ticks3 = epee::misc_utils::get_tick_count(); \
       response_info.m_mime_tipe = " application/octet-stream"; \
       response_info.m_header_info.m_content_type = " application/octet-stream"; \
+      HANDLER_LATENCY_FINISH(s_pattern); \
       LOG_PRINT( "[HTTP/BIN][" << epee::string_tools::get_ip_string_from_int32(m_conn_context.m_remote_ip ) << "][" << query_info.m_URI << "] processed with " << ticks1-ticks << "/"<< ticks2-ticks1 << "/" << ticks3-ticks2 << "ms", LOG_LEVEL_2); \
     }
 
@@ -228,8 +295,9 @@ struct json_command_type_t
     { \
     if(query_info.m_URI == JSON_RPC_REFERENCE_MARKER) {generate_reference = "JSON RPC URL: " uri "\n";} \
     LOG_PRINT_L4("[JSON_REQUEST_BODY]: " << ENDL << query_info.m_body); \
+    HANDLER_LATENCY_START(); \
     uint64_t ticks = epee::misc_utils::get_tick_count(); \
-    epee::serialization::portable_storage ps; \
+    epee::serialization::json_on_demand_reader ps; \
     if(!ps.load_from_json(query_info.m_body)) \
     { \
        boost::value_initialized<epee::json_rpc::error_response> rsp; \
@@ -278,10 +346,11 @@ struct json_command_type_t
 
 #define FINALIZE_OBJECTS_TO_JSON(method_name) \
   uint64_t ticks2 = epee::misc_utils::get_tick_count(); \
-  epee::serialization::store_t_to_json(resp, response_info.m_body); \
+  epee::serialization::store_t_to_json_stream(resp, response_info.m_body); \
   uint64_t ticks3 = epee::misc_utils::get_tick_count(); \
   response_info.m_mime_tipe = "application/json"; \
   response_info.m_header_info.m_content_type = " application/json"; \
+  HANDLER_LATENCY_FINISH(std::string("json_rpc.") + method_name); \
   LOG_PRINT( query_info.m_URI << "[" << method_name << "] processed with " << ticks1-ticks << "/"<< ticks2-ticks1 << "/" << ticks3-ticks2 << "ms", LOG_LEVEL_2);
 
 #define MAP_JON_RPC_WE(method_name, callback_f, command_type) \
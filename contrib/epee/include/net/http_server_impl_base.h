@@ -33,7 +33,7 @@
 #include <boost/thread.hpp>
 #include <boost/bind/bind.hpp> 
 
-using namespace boost::placeholders
+using namespace boost::placeholders;
 
 #include "net/http_server_cp2.h"
 #include "net/http_server_handlers_map2.h"
@@ -39,7 +39,7 @@
 #include <boost/archive/iterators/transform_width.hpp>
 #include <boost/archive/iterators/ostream_iterator.hpp>
 
-using namespace boost::placeholders
+using namespace boost::placeholders;
 
 namespace epee
 {
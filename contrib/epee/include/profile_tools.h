@@ -31,6 +31,11 @@
 
 #include <chrono>
 #include <atomic>
+#include <mutex>
+#include <list>
+#include <vector>
+#include <memory>
+#include <ostream>
 #include "misc_log_ex.h"
 #include "print_fixed_point_helper.h"
 #define ENABLE_PROFILING
@@ -59,6 +64,20 @@ namespace epee
 #define PROFILE_FUNC_ACC(profile_name_str) 
 #endif
 
+#define ENABLE_TRACING
+#define TRACE_DEFAULT_EVENTS_PER_THREAD    16384
+
+#ifdef ENABLE_TRACING
+#define TRACE_SPAN_CONCAT_(a, b) a##b
+#define TRACE_SPAN_CONCAT(a, b) TRACE_SPAN_CONCAT_(a, b)
+// name_str has to be a string literal, spans are recorded only while tracer is enabled
+#define TRACE_SPAN(name_str) epee::profile_tools::trace_span TRACE_SPAN_CONCAT(local_trace_span_, __LINE__)(name_str);
+#define TRACE_SPAN_COND(cond, name_str) epee::profile_tools::trace_span TRACE_SPAN_CONCAT(local_trace_span_, __LINE__)(name_str, cond);
+#else
+#define TRACE_SPAN(name_str)
+#define TRACE_SPAN_COND(cond, name_str)
+#endif
+
 #define START_WAY_POINTS() uint64_t _____way_point_time = misc_utils::get_tick_count();
 #define WAY_POINT(name) {uint64_t delta = misc_utils::get_tick_count()-_____way_point_time; LOG_PRINT("Way point " << name << ": " << delta, LOG_LEVEL_2);_____way_point_time = misc_utils::get_tick_count();}
 #define WAY_POINT2(name, avrg_obj) {uint64_t delta = misc_utils::get_tick_count()-_____way_point_time; avrg_obj.push(delta); LOG_PRINT("Way point " << name << ": " << delta, LOG_LEVEL_2);_____way_point_time = misc_utils::get_tick_count();}
@@ -147,6 +166,154 @@ namespace profile_tools
 		local_call_account& m_cc;
 		boost::posix_time::ptime m_call_time;
 	};
+
+
+  /************************************************************************/
+  /* timeline tracing: spans go to per-thread rings and can be dumped    */
+  /* as Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev)       */
+  /************************************************************************/
+  struct trace_event
+  {
+    const char* name; // only the pointer is stored, so it has to be a literal
+    uint64_t start_us;
+    uint64_t duration_us;
+  };
+
+  class trace_thread_buffer
+  {
+  public:
+    trace_thread_buffer(size_t capacity, uint64_t thread_index) :m_events(capacity), m_written(0), m_thread_index(thread_index)
+    {}
+
+    void add(const char* name, uint64_t start_us, uint64_t duration_us)
+    {
+      // the lock is taken by the owner thread only, unless somebody is dumping right now
+      std::lock_guard<std::mutex> lk(m_lock);
+      trace_event& e = m_events[m_written % m_events.size()];
+      e.name = name;
+      e.start_us = start_us;
+      e.duration_us = duration_us;
+      m_written++;
+    }
+
+    template<class t_cb>
+    void enumerate(t_cb cb)
+    {
+      std::lock_guard<std::mutex> lk(m_lock);
+      uint64_t count = (std::min)(m_written, static_cast<uint64_t>(m_events.size()));
+      for (uint64_t i = m_written - count; i != m_written; i++)
+        cb(m_events[i % m_events.size()]);
+    }
+
+    uint64_t get_thread_index() const { return m_thread_index; }
+
+  private:
+    std::mutex m_lock;
+    std::vector<trace_event> m_events;
+    uint64_t m_written;
+    const uint64_t m_thread_index;
+  };
+
+  class tracer
+  {
+  public:
+    static tracer& instance()
+    {
+      static tracer t;
+      return t;
+    }
+
+    static uint64_t now_us()
+    {
+      return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool is_enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    void enable(size_t events_per_thread = TRACE_DEFAULT_EVENTS_PER_THREAD)
+    {
+      m_events_per_thread = events_per_thread ? events_per_thread : TRACE_DEFAULT_EVENTS_PER_THREAD;
+      m_enabled = true;
+    }
+
+    void disable()
+    {
+      m_enabled = false;
+    }
+
+    void add(const char* name, uint64_t start_us, uint64_t duration_us)
+    {
+      get_thread_buffer().add(name, start_us, duration_us);
+    }
+
+    //returns number of events written
+    size_t dump_chrome_trace(uint64_t last_seconds, std::ostream& out)
+    {
+      uint64_t now = now_us();
+      uint64_t since = now > last_seconds * 1000000 ? now - last_seconds * 1000000 : 0;
+      std::list<std::shared_ptr<trace_thread_buffer> > buffers;
+      {
+        std::lock_guard<std::mutex> lk(m_buffers_lock);
+        buffers = m_buffers;
+      }
+
+      size_t count = 0;
+      out << "{\"traceEvents\":[";
+      for (auto& pb : buffers)
+      {
+        uint64_t tid = pb->get_thread_index();
+        out << (count ? "," : "") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":\"thread " << tid << "\"}}";
+        count++;
+        pb->enumerate([&](const trace_event& e)
+        {
+          if (e.start_us + e.duration_us < since)
+            return;
+          out << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << e.start_us << ",\"dur\":" << e.duration_us << "}";
+          count++;
+        });
+      }
+      out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+      return count;
+    }
+
+  private:
+    tracer() :m_enabled(false), m_events_per_thread(TRACE_DEFAULT_EVENTS_PER_THREAD), m_threads_count(0)
+    {}
+
+    trace_thread_buffer& get_thread_buffer()
+    {
+      static thread_local std::shared_ptr<trace_thread_buffer> thread_buffer;
+      if (!thread_buffer)
+      {
+        thread_buffer.reset(new trace_thread_buffer(m_events_per_thread, m_threads_count++));
+        std::lock_guard<std::mutex> lk(m_buffers_lock);
+        m_buffers.push_back(thread_buffer);
+      }
+      return *thread_buffer;
+    }
+
+    std::atomic<bool> m_enabled;
+    std::atomic<size_t> m_events_per_thread;
+    std::atomic<uint64_t> m_threads_count;
+    std::mutex m_buffers_lock;
+    std::list<std::shared_ptr<trace_thread_buffer> > m_buffers;
+  };
+
+  struct trace_span
+  {
+    trace_span(const char* name, bool condition = true) :m_name(name), m_start_us(condition && tracer::instance().is_enabled() ? tracer::now_us() : 0)
+    {}
+
+    ~trace_span()
+    {
+      if (m_start_us)
+        tracer::instance().add(m_name, m_start_us, tracer::now_us() - m_start_us);
+    }
+
+  private:
+    const char* m_name;
+    uint64_t m_start_us;
+  };
 	
 
 }
@@ -0,0 +1,319 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "misc_log_ex.h"
+#include "portable_storage_base.h"
+#include "portable_storage_to_bin.h"
+
+namespace epee
+{
+  namespace serialization
+  {
+    /************************************************************************/
+    /* Write-only storage for KV serialization (BEGIN_KV_SERIALIZE_MAP)     */
+    /* that produces the same bytes as portable_storage::store_to_binary(). */
+    /*                                                                      */
+    /* store() fills a flat tree of nodes kept in one deque. Names are      */
+    /* interned, values are appended to one buffer already encoded, and     */
+    /* arrays of PODs and strings are a single node over a contiguous run   */
+    /* of that buffer. store_to_binary() then writes each section's entries */
+    /* sorted by name, as std::map would keep them.                         */
+    /*                                                                      */
+    /* As with portable_storage, a name written twice in a section keeps    */
+    /* the last value.                                                      */
+    /************************************************************************/
+    class binary_flat_writer
+    {
+      static const uint8_t type_encoded = 0; // storage_entry, kept in m_data with its type byte
+
+      struct node
+      {
+        uint8_t type;           // SERIALIZE_TYPE_*, arrays have SERIALIZE_FLAG_ARRAY set
+        uint32_t name;          // index in m_names
+        uint64_t count;         // array: number of elements
+        size_t offset;          // encoded value (or array elements) in m_data
+        size_t length;
+        node* first_child;      // section: entries, array of sections: elements
+        node* last_child;
+        node* next_sibling;
+      };
+
+      struct string_sink
+      {
+        std::string& m_buff;
+        void write(const char* p, size_t count) { m_buff.append(p, count); }
+      };
+
+    public:
+      typedef node* hsection;
+      typedef node* harray;
+      typedef storage_entry meta_entry;
+
+      binary_flat_writer()
+      {
+        m_nodes.push_back(make_node(SERIALIZE_TYPE_OBJECT, no_name));
+      }
+
+      hsection open_section(const std::string& section_name, hsection hparent_section, bool /*create_if_notexist*/ = true)
+      {
+        return add_entry(section_name, hparent_section, SERIALIZE_TYPE_OBJECT);
+      }
+
+      template<class t_value>
+      bool set_value(const std::string& value_name, const t_value& v, hsection hparent_section)
+      {
+        node* pn = add_entry(value_name, hparent_section, type_of(v));
+        pn->offset = m_data.size();
+        encode(v);
+        pn->length = m_data.size() - pn->offset;
+        return true;
+      }
+
+      bool set_value(const std::string& value_name, const storage_entry& v, hsection hparent_section)
+      {
+        node* pn = add_entry(value_name, hparent_section, type_encoded);
+        pn->offset = m_data.size();
+        string_sink sink = { m_data };
+        pack_entry_to_buff(sink, v);
+        pn->length = m_data.size() - pn->offset;
+        return true;
+      }
+
+      template<class t_value>
+      harray insert_first_value(const std::string& value_name, const t_value& v, hsection hparent_section)
+      {
+        node* pa = add_entry(value_name, hparent_section, type_of(v) | SERIALIZE_FLAG_ARRAY);
+        pa->offset = m_data.size();
+        insert_next_value(pa, v);
+        return pa;
+      }
+
+      template<class t_value>
+      bool insert_next_value(harray hval_array, const t_value& v)
+      {
+        CHECK_AND_ASSERT(hval_array, false);
+        CHECK_AND_ASSERT_MES(hval_array->type == (type_of(v) | SERIALIZE_FLAG_ARRAY), false, "unexpected type in insert_next_value: " << typeid(t_value).name());
+        if (hval_array->offset + hval_array->length != m_data.size())
+        {
+          // something was written after this array, move its elements to the end to keep them contiguous
+          std::string elements = m_data.substr(hval_array->offset, hval_array->length);
+          hval_array->offset = m_data.size();
+          m_data += elements;
+        }
+        encode(v);
+        hval_array->length = m_data.size() - hval_array->offset;
+        ++hval_array->count;
+        return true;
+      }
+
+      harray insert_first_section(const std::string& sec_name, hsection& hinserted_childsection, hsection hparent_section)
+      {
+        node* pa = add_entry(sec_name, hparent_section, SERIALIZE_TYPE_OBJECT | SERIALIZE_FLAG_ARRAY);
+        insert_next_section(pa, hinserted_childsection);
+        return pa;
+      }
+
+      bool insert_next_section(harray hsec_array, hsection& hinserted_childsection)
+      {
+        CHECK_AND_ASSERT(hsec_array, false);
+        CHECK_AND_ASSERT_MES(hsec_array->type == (SERIALIZE_TYPE_OBJECT | SERIALIZE_FLAG_ARRAY), false, "unexpected type(not 'section') in insert_next_section");
+        m_nodes.push_back(make_node(SERIALIZE_TYPE_OBJECT, no_name));
+        hinserted_childsection = &m_nodes.back();
+        append_child(*hsec_array, hinserted_childsection);
+        ++hsec_array->count;
+        return true;
+      }
+
+      bool store_to_binary(binarybuffer& target)
+      {
+        TRY_ENTRY();
+        target.clear();
+        target.reserve(m_data.size() + m_nodes.size() * 8 + 16);
+        string_sink sink = { target };
+        uint32_t signature_a = PORTABLE_STORAGE_SIGNATUREA;
+        uint32_t signature_b = PORTABLE_STORAGE_SIGNATUREB;
+        uint8_t ver = PORTABLE_STORAGE_FORMAT_VER;
+        sink.write(reinterpret_cast<const char*>(&signature_a), sizeof(signature_a));
+        sink.write(reinterpret_cast<const char*>(&signature_b), sizeof(signature_b));
+        sink.write(reinterpret_cast<const char*>(&ver), sizeof(ver));
+
+        rank_names();
+        m_order.clear();
+        write_section(sink, m_nodes.front());
+        return true;
+        CATCH_ENTRY("binary_flat_writer::store_to_binary", false);
+      }
+
+    private:
+      static const uint32_t no_name = UINT32_MAX;
+
+      static node make_node(uint8_t type, uint32_t name)
+      {
+        node n = AUTO_VAL_INIT(n);
+        n.type = type;
+        n.name = name;
+        return n;
+      }
+
+      uint32_t intern_name(const std::string& name)
+      {
+        auto it = m_name_ids.find(name);
+        if (it != m_name_ids.end())
+          return it->second;
+        uint32_t id = static_cast<uint32_t>(m_names.size());
+        m_names.push_back(name);
+        m_name_ids.insert(std::make_pair(name, id));
+        return id;
+      }
+
+      static void append_child(node& parent, node* pchild)
+      {
+        if (parent.last_child)
+          parent.last_child->next_sibling = pchild;
+        else
+          parent.first_child = pchild;
+        parent.last_child = pchild;
+      }
+
+      node* add_entry(const std::string& name, hsection hparent_section, uint8_t type)
+      {
+        node& parent = hparent_section ? *hparent_section : m_nodes.front();
+        CHECK_AND_ASSERT_THROW_MES(parent.type == SERIALIZE_TYPE_OBJECT, "binary_flat_writer: section handle is not a section");
+        m_nodes.push_back(make_node(type, intern_name(name)));
+        node* pn = &m_nodes.back();
+        append_child(parent, pn);
+        return pn;
+      }
+
+      //------------------------------------------------------------------------------------------------------------------
+      // values, encoded as portable_storage_to_bin.h does
+      static uint8_t type_of(const uint64_t&)    { return SERIALIZE_TYPE_UINT64; }
+      static uint8_t type_of(const uint32_t&)    { return SERIALIZE_TYPE_UINT32; }
+      static uint8_t type_of(const uint16_t&)    { return SERIALIZE_TYPE_UINT16; }
+      static uint8_t type_of(const uint8_t&)     { return SERIALIZE_TYPE_UINT8; }
+      static uint8_t type_of(const int64_t&)     { return SERIALIZE_TYPE_INT64; }
+      static uint8_t type_of(const int32_t&)     { return SERIALIZE_TYPE_INT32; }
+      static uint8_t type_of(const int16_t&)     { return SERIALIZE_TYPE_INT16; }
+      static uint8_t type_of(const int8_t&)      { return SERIALIZE_TYPE_INT8; }
+      static uint8_t type_of(const double&)      { return SERIALIZE_TYPE_DUOBLE; }
+      static uint8_t type_of(const bool&)        { return SERIALIZE_TYPE_BOOL; }
+      static uint8_t type_of(const std::string&) { return SERIALIZE_TYPE_STRING; }
+
+      template<class t_pod>
+      void encode(const t_pod& v)
+      {
+        m_data.append(reinterpret_cast<const char*>(&v), sizeof(v));
+      }
+
+      void encode(const std::string& v)
+      {
+        string_sink sink = { m_data };
+        put_string(sink, v);
+      }
+
+      //------------------------------------------------------------------------------------------------------------------
+      // output
+      void rank_names()
+      {
+        std::vector<uint32_t> ids(m_names.size());
+        for (uint32_t i = 0; i != ids.size(); ++i)
+          ids[i] = i;
+        std::sort(ids.begin(), ids.end(), [this](uint32_t l, uint32_t r) { return m_names[l] < m_names[r]; });
+        m_name_ranks.resize(m_names.size());
+        for (uint32_t i = 0; i != ids.size(); ++i)
+          m_name_ranks[ids[i]] = i;
+      }
+
+      // stable, so of equal names the last written stays last; sections are small, insertion sort does without allocations
+      void sort_by_name(size_t begin)
+      {
+        auto less = [this](const node* l, const node* r) { return m_name_ranks[l->name] < m_name_ranks[r->name]; };
+        if (m_order.size() - begin > 32)
+        {
+          std::stable_sort(m_order.begin() + begin, m_order.end(), less);
+          return;
+        }
+        for (size_t i = begin + 1; i < m_order.size(); ++i)
+        {
+          const node* pn = m_order[i];
+          size_t j = i;
+          for (; j != begin && less(pn, m_order[j - 1]); --j)
+            m_order[j] = m_order[j - 1];
+          m_order[j] = pn;
+        }
+      }
+
+      void write_section(string_sink& sink, const node& sec)
+      {
+        // m_order is shared by all levels of recursion, this section uses [begin, end)
+        size_t begin = m_order.size();
+        for (const node* pn = sec.first_child; pn; pn = pn->next_sibling)
+          m_order.push_back(pn);
+        sort_by_name(begin);
+        // of equal names keep the last one written
+        size_t end = begin;
+        for (size_t i = begin; i != m_order.size(); ++i)
+        {
+          if (end != begin && m_order[end - 1]->name == m_order[i]->name)
+            m_order[end - 1] = m_order[i];
+          else
+            m_order[end++] = m_order[i];
+        }
+        m_order.resize(end);
+
+        pack_varint(sink, end - begin);
+        for (size_t i = begin; i != end; ++i)
+        {
+          const node& n = *m_order[i];
+          const std::string& name = m_names[n.name];
+          CHECK_AND_ASSERT_THROW_MES(name.size() < std::numeric_limits<uint8_t>::max(), "storage_entry_name is too long: " << name.size() << ", val: " << name);
+          uint8_t len = static_cast<uint8_t>(name.size());
+          sink.write(reinterpret_cast<const char*>(&len), sizeof(len));
+          sink.write(name.data(), name.size());
+          write_entry(sink, n);
+        }
+        m_order.resize(begin);
+      }
+
+      void write_entry(string_sink& sink, const node& n)
+      {
+        if (n.type != type_encoded)
+          sink.write(reinterpret_cast<const char*>(&n.type), sizeof(n.type));
+
+        if (n.type == SERIALIZE_TYPE_OBJECT)
+        {
+          write_section(sink, n);
+        }
+        else if (n.type == (SERIALIZE_TYPE_OBJECT | SERIALIZE_FLAG_ARRAY))
+        {
+          pack_varint(sink, n.count);
+          for (const node* pn = n.first_child; pn; pn = pn->next_sibling)
+            write_section(sink, *pn);
+        }
+        else
+        {
+          if (n.type & SERIALIZE_FLAG_ARRAY)
+            pack_varint(sink, n.count);
+          sink.write(m_data.data() + n.offset, n.length);
+        }
+      }
+
+      std::deque<node> m_nodes;     // deque keeps handles valid while it grows; [0] is the root
+      std::string m_data;
+      std::vector<std::string> m_names;
+      std::unordered_map<std::string, uint32_t> m_name_ids;
+      std::vector<uint32_t> m_name_ranks;
+      std::vector<const node*> m_order;
+    };
+  }
+}
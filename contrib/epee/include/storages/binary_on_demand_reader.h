@@ -0,0 +1,433 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "misc_log_ex.h"
+#include "portable_storage_base.h"
+#include "portable_storage_from_bin.h"
+#include "portable_storage_val_converters.h"
+
+namespace epee
+{
+  namespace serialization
+  {
+    /************************************************************************/
+    /* Read-only storage for KV serialization (BEGIN_KV_SERIALIZE_MAP)      */
+    /* that loads structs straight from portable_storage binary format.     */
+    /*                                                                      */
+    /* One pass over the buffer builds a flat vector of nodes that point    */
+    /* into it: names and strings are slices of the buffer, arrays of PODs  */
+    /* and strings are a single node read element by element. No section   */
+    /* tree, std::map, std::list or boost::variant per entry is built,      */
+    /* unlike portable_storage::load_from_binary().                         */
+    /*                                                                      */
+    /* The buffer is not copied and has to outlive the reader. Values are   */
+    /* converted by the same rules (convert_t) as portable_storage; of      */
+    /* duplicated names the first one is used, as std::map::insert() does.  */
+    /************************************************************************/
+    class binary_on_demand_reader
+    {
+      struct node
+      {
+        uint8_t type;           // SERIALIZE_TYPE_*, arrays have SERIALIZE_FLAG_ARRAY set
+        uint8_t name_length;
+        uint32_t name_offset;
+        uint32_t next;          // index of the node following this one with all its children
+        uint32_t offset;        // value: position of its data; array of PODs/strings: position of the first element
+        uint32_t end;           // array of PODs/strings: position after the last element
+        mutable uint32_t cursor; // array: position (or node index for sections) of the element get_next_*() returns
+      };
+
+    public:
+      typedef const node* hsection;
+      typedef const node* harray;
+      typedef storage_entry meta_entry;
+
+      static const size_t max_depth = EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL;
+
+      binary_on_demand_reader()
+        : m_ptr(nullptr)
+        , m_size(0)
+      {
+        clear();
+      }
+
+      bool load_from_binary(const binarybuffer& source)
+      {
+        clear();
+        if (source.size() < header_size)
+        {
+          LOG_ERROR("portable_storage: wrong binary format, packet size = " << source.size() << " less than expected sizeof(storage_block_header)=" << header_size);
+          return false;
+        }
+        if (source.size() > UINT32_MAX)
+        {
+          LOG_ERROR("portable_storage: packet size = " << source.size() << " is too big");
+          return false;
+        }
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(source.data());
+        if (read_pod<uint32_t>(p) != PORTABLE_STORAGE_SIGNATUREA || read_pod<uint32_t>(p + 4) != PORTABLE_STORAGE_SIGNATUREB)
+        {
+          LOG_PRINT_RED_L0("portable_storage: wrong binary format - signature missmatch");
+          return false;
+        }
+        if (p[8] != PORTABLE_STORAGE_FORMAT_VER)
+        {
+          LOG_ERROR("portable_storage: wrong binary format - unknown format ver = " << p[8]);
+          return false;
+        }
+
+        m_ptr = p;
+        m_size = source.size();
+        try
+        {
+          size_t pos = header_size;
+          m_nodes.pop_back(); // root placeholder
+          parse_section(pos, 0, make_node(SERIALIZE_TYPE_OBJECT));
+          return true;
+        }
+        catch (const std::exception& ex)
+        {
+          LOG_PRINT_RED_L0("Failed to parse binary storage, what: " << ex.what());
+        }
+        catch (...)
+        {
+          LOG_PRINT_RED_L0("Failed to parse binary storage");
+        }
+        clear();
+        return false;
+      }
+      // the buffer is referenced, not copied
+      bool load_from_binary(binarybuffer&& source) = delete;
+
+      hsection open_section(const std::string& section_name, hsection hparent_section, bool create_if_notexist = false)
+      {
+        const node* pn = find_value(section_name, hparent_section);
+        if (pn && pn->type == SERIALIZE_TYPE_OBJECT)
+          return pn;
+        // portable_storage creates missing (or replaces non-object) section here, so loading a missing sub-object gives defaults
+        return create_if_notexist ? &m_nodes[0] : nullptr;
+      }
+
+      template<class t_value>
+      bool get_value(const std::string& value_name, t_value& val, hsection hparent_section)
+      {
+        const node* pn = find_value(value_name, hparent_section);
+        if (!pn)
+          return false;
+        size_t pos = pn->offset;
+        read_element(pn->type, pos, val);
+        return true;
+      }
+
+      bool get_value(const std::string& value_name, storage_entry& val, hsection hparent_section)
+      {
+        const node* pn = find_value(value_name, hparent_section);
+        if (!pn)
+          return false;
+        // rarely used, so portable_storage's own loader reads the entry from its type byte on
+        size_t entry_offset = pn->name_offset + pn->name_length;
+        throwable_buffer_reader reader(m_ptr + entry_offset, m_size - entry_offset);
+        val = reader.load_storage_entry();
+        return true;
+      }
+
+      template<class t_value>
+      harray get_first_value(const std::string& value_name, t_value& target, hsection hparent_section)
+      {
+        const node* pa = find_value(value_name, hparent_section);
+        if (!pa || !(pa->type & SERIALIZE_FLAG_ARRAY))
+          return nullptr;
+        if (pa->type == (SERIALIZE_TYPE_OBJECT | SERIALIZE_FLAG_ARRAY))
+          ASSERT_MES_AND_THROW("WRONG DATA CONVERSION: from section to type " << typeid(t_value).name());
+        pa->cursor = pa->offset;
+        if (!get_next_value(pa, target))
+          return nullptr;
+        return pa;
+      }
+
+      template<class t_value>
+      bool get_next_value(harray hval_array, t_value& target)
+      {
+        CHECK_AND_ASSERT(hval_array, false);
+        if (hval_array->cursor >= hval_array->end)
+          return false;
+        size_t pos = hval_array->cursor;
+        read_element(hval_array->type & ~SERIALIZE_FLAG_ARRAY, pos, target);
+        hval_array->cursor = static_cast<uint32_t>(pos);
+        return true;
+      }
+
+      harray get_first_section(const std::string& sec_name, hsection& h_child_section, hsection hparent_section)
+      {
+        const node* pa = find_value(sec_name, hparent_section);
+        if (!pa || pa->type != (SERIALIZE_TYPE_OBJECT | SERIALIZE_FLAG_ARRAY))
+          return nullptr;
+        pa->cursor = index_of(pa) + 1;
+        if (!get_next_section(pa, h_child_section))
+          return nullptr;
+        return pa;
+      }
+
+      bool get_next_section(harray hsec_array, hsection& h_child_section)
+      {
+        CHECK_AND_ASSERT(hsec_array, false);
+        if (hsec_array->type != (SERIALIZE_TYPE_OBJECT | SERIALIZE_FLAG_ARRAY) || hsec_array->cursor >= hsec_array->next)
+          return false;
+        const node& el = m_nodes[hsec_array->cursor];
+        h_child_section = &el;
+        hsec_array->cursor = el.next;
+        return true;
+      }
+
+    private:
+      static const size_t header_size = sizeof(uint32_t) * 2 + sizeof(uint8_t);
+
+      void clear()
+      {
+        m_ptr = nullptr;
+        m_size = 0;
+        m_nodes.clear();
+        // [0] is an empty section returned by open_section() for missing sections, [1] is the root
+        m_nodes.push_back(make_node(SERIALIZE_TYPE_OBJECT, 1));
+        m_nodes.push_back(make_node(SERIALIZE_TYPE_OBJECT, 2));
+      }
+
+      static node make_node(uint8_t type, uint32_t next = 0)
+      {
+        node n = AUTO_VAL_INIT(n);
+        n.type = type;
+        n.next = next;
+        return n;
+      }
+
+      uint32_t index_of(const node* pn) const
+      {
+        return static_cast<uint32_t>(pn - m_nodes.data());
+      }
+
+      template<class t_pod>
+      static t_pod read_pod(const uint8_t* p)
+      {
+        t_pod v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+      }
+
+      static size_t pod_size(uint8_t type)
+      {
+        switch (type)
+        {
+        case SERIALIZE_TYPE_INT64:
+        case SERIALIZE_TYPE_UINT64:
+        case SERIALIZE_TYPE_DUOBLE: return 8;
+        case SERIALIZE_TYPE_INT32:
+        case SERIALIZE_TYPE_UINT32: return 4;
+        case SERIALIZE_TYPE_INT16:
+        case SERIALIZE_TYPE_UINT16: return 2;
+        case SERIALIZE_TYPE_INT8:
+        case SERIALIZE_TYPE_UINT8:
+        case SERIALIZE_TYPE_BOOL:   return 1;
+        default:                    return 0;
+        }
+      }
+
+      //------------------------------------------------------------------------------------------------------------------
+      // lookup
+      const node* find_value(const std::string& name, hsection hparent_section) const
+      {
+        const node* psec = hparent_section ? hparent_section : &m_nodes[1];
+        CHECK_AND_ASSERT_MES(psec->type == SERIALIZE_TYPE_OBJECT, nullptr, "binary_on_demand_reader: section handle is not a section");
+        for (uint32_t i = index_of(psec) + 1; i < psec->next; i = m_nodes[i].next)
+        {
+          const node& n = m_nodes[i];
+          if (n.name_length == name.size() && memcmp(m_ptr + n.name_offset, name.data(), name.size()) == 0)
+            return &n;
+        }
+        return nullptr;
+      }
+
+      //------------------------------------------------------------------------------------------------------------------
+      // conversion, follows portable_storage::get_value() semantics; pos is moved past the element
+      template<class t_value>
+      void read_element(uint8_t type, size_t& pos, t_value& val) const
+      {
+        const uint8_t* p = m_ptr + pos;
+        pos += pod_size(type);
+        switch (type)
+        {
+        case SERIALIZE_TYPE_INT64:  convert_t(read_pod<int64_t>(p), val);  break;
+        case SERIALIZE_TYPE_INT32:  convert_t(read_pod<int32_t>(p), val);  break;
+        case SERIALIZE_TYPE_INT16:  convert_t(read_pod<int16_t>(p), val);  break;
+        case SERIALIZE_TYPE_INT8:   convert_t(read_pod<int8_t>(p), val);   break;
+        case SERIALIZE_TYPE_UINT64: convert_t(read_pod<uint64_t>(p), val); break;
+        case SERIALIZE_TYPE_UINT32: convert_t(read_pod<uint32_t>(p), val); break;
+        case SERIALIZE_TYPE_UINT16: convert_t(read_pod<uint16_t>(p), val); break;
+        case SERIALIZE_TYPE_UINT8:  convert_t(read_pod<uint8_t>(p), val);  break;
+        case SERIALIZE_TYPE_DUOBLE: convert_t(read_pod<double>(p), val);   break;
+        case SERIALIZE_TYPE_BOOL:   convert_t(*p != 0, val);              break;
+        case SERIALIZE_TYPE_STRING:
+        {
+          std::string s;
+          read_string(pos, s);
+          convert_t(s, val);
+          break;
+        }
+        default:
+          ASSERT_MES_AND_THROW("WRONG DATA CONVERSION: from type=" << static_cast<uint32_t>(type) << " to type " << typeid(t_value).name());
+        }
+      }
+
+      void read_element(uint8_t type, size_t& pos, std::string& val) const
+      {
+        if (type == SERIALIZE_TYPE_STRING)
+          read_string(pos, val);
+        else
+          read_element<std::string>(type, pos, val);
+      }
+
+      // the string was validated by parse_string()
+      void read_string(size_t& pos, std::string& val) const
+      {
+        size_t len = static_cast<size_t>(read_varint(pos));
+        val.assign(reinterpret_cast<const char*>(m_ptr) + pos, len);
+        pos += len;
+      }
+
+      //------------------------------------------------------------------------------------------------------------------
+      // parsing
+      void need(size_t pos, size_t count) const
+      {
+        CHECK_AND_ASSERT_THROW_MES(m_size - pos >= count, "attempt to read " << count << " bytes from buffer with " << m_size - pos << " bytes remained");
+      }
+
+      uint8_t read_byte(size_t& pos) const
+      {
+        need(pos, 1);
+        return m_ptr[pos++];
+      }
+
+      uint64_t read_varint(size_t& pos) const
+      {
+        need(pos, 1);
+        uint64_t v = 0;
+        switch (m_ptr[pos] & PORTABLE_RAW_SIZE_MARK_MASK)
+        {
+        case PORTABLE_RAW_SIZE_MARK_BYTE:  need(pos, 1); v = m_ptr[pos]; pos += 1; break;
+        case PORTABLE_RAW_SIZE_MARK_WORD:  need(pos, 2); v = read_pod<uint16_t>(m_ptr + pos); pos += 2; break;
+        case PORTABLE_RAW_SIZE_MARK_DWORD: need(pos, 4); v = read_pod<uint32_t>(m_ptr + pos); pos += 4; break;
+        default:                           need(pos, 8); v = read_pod<uint64_t>(m_ptr + pos); pos += 8; break;
+        }
+        return v >> 2;
+      }
+
+      void parse_string(size_t& pos) const
+      {
+        uint64_t len = read_varint(pos);
+        CHECK_AND_ASSERT_THROW_MES(len < MAX_STRING_LEN_POSSIBLE, "to big string len value in storage: " << len);
+        CHECK_AND_ASSERT_THROW_MES(m_size - pos >= len, "string len count value " << len << " goes out of remain storage len " << m_size - pos);
+        pos += static_cast<size_t>(len);
+      }
+
+      // n carries the name; the node is pushed before its children
+      void parse_section(size_t& pos, size_t depth, node n)
+      {
+        CHECK_AND_ASSERT_THROW_MES(depth < max_depth, "Wrong blob data in portable storage: recursion limitation (" << max_depth << ") exceeded");
+        size_t idx = m_nodes.size();
+        m_nodes.push_back(n);
+        uint64_t count = read_varint(pos);
+        while (count--)
+        {
+          node entry = make_node(0);
+          entry.name_length = read_byte(pos);
+          need(pos, entry.name_length);
+          entry.name_offset = static_cast<uint32_t>(pos);
+          pos += entry.name_length;
+          parse_entry(pos, depth, entry);
+        }
+        m_nodes[idx].next = static_cast<uint32_t>(m_nodes.size());
+      }
+
+      void parse_entry(size_t& pos, size_t depth, node n)
+      {
+        uint8_t type = read_byte(pos);
+        if (type == SERIALIZE_TYPE_ARRAY)
+        {
+          type = read_byte(pos);
+          CHECK_AND_ASSERT_THROW_MES(type & SERIALIZE_FLAG_ARRAY, "wrong type sequenses");
+        }
+        if (type & SERIALIZE_FLAG_ARRAY)
+        {
+          parse_array(pos, depth, n, type);
+          return;
+        }
+
+        n.type = type;
+        n.offset = static_cast<uint32_t>(pos);
+        if (type == SERIALIZE_TYPE_OBJECT)
+        {
+          parse_section(pos, depth + 1, n);
+          return;
+        }
+        if (type == SERIALIZE_TYPE_STRING)
+        {
+          parse_string(pos);
+        }
+        else
+        {
+          size_t sz = pod_size(type);
+          CHECK_AND_ASSERT_THROW_MES(sz, "unknown entry_type code = " << static_cast<uint32_t>(type));
+          need(pos, sz);
+          pos += sz;
+        }
+        n.next = static_cast<uint32_t>(m_nodes.size() + 1);
+        m_nodes.push_back(n);
+      }
+
+      void parse_array(size_t& pos, size_t depth, node n, uint8_t type)
+      {
+        uint8_t el_type = type & ~SERIALIZE_FLAG_ARRAY;
+        n.type = type;
+        uint64_t count = read_varint(pos);
+        n.offset = static_cast<uint32_t>(pos);
+        if (el_type == SERIALIZE_TYPE_OBJECT)
+        {
+          CHECK_AND_ASSERT_THROW_MES(depth + 1 < max_depth, "Wrong blob data in portable storage: recursion limitation (" << max_depth << ") exceeded");
+          size_t idx = m_nodes.size();
+          m_nodes.push_back(n);
+          while (count--)
+            parse_section(pos, depth + 1, make_node(SERIALIZE_TYPE_OBJECT));
+          m_nodes[idx].next = static_cast<uint32_t>(m_nodes.size());
+          return;
+        }
+
+        if (el_type == SERIALIZE_TYPE_STRING)
+        {
+          while (count--)
+            parse_string(pos);
+        }
+        else
+        {
+          CHECK_AND_ASSERT_THROW_MES(el_type != SERIALIZE_TYPE_ARRAY, "array of arrays is not supported");
+          size_t sz = pod_size(el_type);
+          CHECK_AND_ASSERT_THROW_MES(sz, "unknown entry_type code = " << static_cast<uint32_t>(el_type));
+          CHECK_AND_ASSERT_THROW_MES(count <= (m_size - pos) / sz, "array of " << count << " elements goes out of remain storage len " << m_size - pos);
+          pos += static_cast<size_t>(count) * sz;
+        }
+        n.end = static_cast<uint32_t>(pos);
+        n.next = static_cast<uint32_t>(m_nodes.size() + 1);
+        m_nodes.push_back(n);
+      }
+
+      const uint8_t* m_ptr;
+      size_t m_size;
+      std::vector<node> m_nodes;
+    };
+  }
+}
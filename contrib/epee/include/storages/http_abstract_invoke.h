@@ -38,7 +38,7 @@ namespace epee
     bool invoke_http_json_remote_command2(const std::string& url, t_request& out_struct, t_response& result_struct, t_transport& transport, unsigned int timeout = 5000, const std::string& method = "GET")
     {
       std::string req_param;
-      if(!serialization::store_t_to_json(out_struct, req_param))
+      if(!serialization::store_t_to_json_stream(out_struct, req_param))
         return false;
 
       const http::http_response_info* pri = NULL;
@@ -60,7 +60,7 @@ namespace epee
         return false;
       }
 
-      return serialization::load_t_from_json(result_struct, pri->m_body);
+      return serialization::load_t_from_json_on_demand(result_struct, pri->m_body);
     }
 
 
@@ -0,0 +1,505 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <boost/algorithm/string/predicate.hpp>
+#include "misc_log_ex.h"
+#include "parserse_base_utils.h"
+#include "portable_storage_base.h"
+#include "portable_storage_val_converters.h"
+
+namespace epee
+{
+  namespace serialization
+  {
+    /************************************************************************/
+    /* Read-only storage for KV serialization (BEGIN_KV_SERIALIZE_MAP)      */
+    /* that loads structs straight from JSON text.                          */
+    /*                                                                      */
+    /* One pass over the text builds a flat vector of nodes (values are     */
+    /* kept as slices of the source, numbers are converted in place), then  */
+    /* _load() looks fields up by linear scan of the object's children. No  */
+    /* section tree, std::map or boost::variant per entry is built, unlike  */
+    /* portable_storage::load_from_json().                                  */
+    /*                                                                      */
+    /* Accepts the same input and converts values by the same rules        */
+    /* (convert_t) as portable_storage, with two exceptions: a truncated    */
+    /* document is an error, and of duplicated keys the first one is used.  */
+    /************************************************************************/
+    class json_on_demand_reader
+    {
+      enum node_type : uint8_t { node_object, node_array, node_string, node_uint64, node_int64, node_double, node_bool, node_null };
+
+      struct node
+      {
+        node_type type;
+        bool has_escapes;       // string: needs unescaping through match_string2()
+        uint32_t next;          // index of the node following this one with all its children
+        mutable uint32_t cursor; // array: index of the element get_next_*() returns
+        size_t offset;          // string: position of opening quote in m_buff
+        size_t length;          // string: length without quotes
+        union
+        {
+          uint64_t u;
+          int64_t i;
+          double d;
+          bool b;
+        } v;
+      };
+
+    public:
+      typedef const node* hsection;
+      typedef const node* harray;
+      typedef storage_entry meta_entry;
+
+      static const size_t max_depth = 100;
+
+      json_on_demand_reader()
+      {
+        clear();
+      }
+
+      bool load_from_json(const std::string& source)
+      {
+        clear();
+        m_buff = source;
+        try
+        {
+          size_t pos = 0;
+          skip_spaces(pos);
+          if (pos == m_buff.size())
+            return true; // empty document is an empty object, as for portable_storage
+          CHECK_AND_ASSERT_THROW_MES(m_buff[pos] == '{', "json: unexpected character at " << pos << ", object expected");
+          m_nodes.pop_back(); // root placeholder
+          parse_object(pos, 0);
+          return true;
+        }
+        catch (const std::exception& ex)
+        {
+          LOG_PRINT_RED_L0("Failed to parse json, what: " << ex.what());
+        }
+        catch (...)
+        {
+          LOG_PRINT_RED_L0("Failed to parse json");
+        }
+        clear();
+        return false;
+      }
+
+      hsection open_section(const std::string& section_name, hsection hparent_section, bool create_if_notexist = false)
+      {
+        const node* pn = find_value(section_name, hparent_section);
+        if (pn && pn->type == node_object)
+          return pn;
+        // portable_storage creates missing (or replaces non-object) section here, so loading a missing sub-object gives defaults
+        return create_if_notexist ? &m_nodes[0] : nullptr;
+      }
+
+      template<class t_value>
+      bool get_value(const std::string& value_name, t_value& val, hsection hparent_section)
+      {
+        const node* pn = find_value(value_name, hparent_section);
+        if (!pn)
+          return false;
+        node_to_value(*pn, val);
+        return true;
+      }
+
+      bool get_value(const std::string& value_name, storage_entry& val, hsection hparent_section)
+      {
+        const node* pn = find_value(value_name, hparent_section);
+        if (!pn)
+          return false;
+        val = node_to_storage_entry(*pn);
+        return true;
+      }
+
+      template<class t_value>
+      harray get_first_value(const std::string& value_name, t_value& target, hsection hparent_section)
+      {
+        const node* pa = find_value(value_name, hparent_section);
+        if (!pa || pa->type != node_array)
+          return nullptr;
+        pa->cursor = index_of(pa) + 1;
+        if (!get_next_value(pa, target))
+          return nullptr;
+        return pa;
+      }
+
+      template<class t_value>
+      bool get_next_value(harray hval_array, t_value& target)
+      {
+        CHECK_AND_ASSERT(hval_array, false);
+        if (hval_array->cursor >= hval_array->next)
+          return false;
+        const node& el = m_nodes[hval_array->cursor];
+        node_to_value(el, target);
+        hval_array->cursor = el.next;
+        return true;
+      }
+
+      harray get_first_section(const std::string& sec_name, hsection& h_child_section, hsection hparent_section)
+      {
+        const node* pa = find_value(sec_name, hparent_section);
+        if (!pa || pa->type != node_array)
+          return nullptr;
+        pa->cursor = index_of(pa) + 1;
+        if (!get_next_section(pa, h_child_section))
+          return nullptr;
+        return pa;
+      }
+
+      bool get_next_section(harray hsec_array, hsection& h_child_section)
+      {
+        CHECK_AND_ASSERT(hsec_array, false);
+        if (hsec_array->cursor >= hsec_array->next)
+          return false;
+        const node& el = m_nodes[hsec_array->cursor];
+        if (el.type != node_object)
+          return false;
+        h_child_section = &el;
+        hsec_array->cursor = el.next;
+        return true;
+      }
+
+    private:
+      void clear()
+      {
+        m_buff.clear();
+        m_nodes.clear();
+        // [0] is an empty object returned by open_section() for missing sections, [1] is the root
+        m_nodes.push_back(make_node(node_object, 1));
+        m_nodes.push_back(make_node(node_object, 2));
+      }
+
+      static node make_node(node_type t, uint32_t next = 0)
+      {
+        node n = AUTO_VAL_INIT(n);
+        n.type = t;
+        n.next = next;
+        return n;
+      }
+
+      uint32_t index_of(const node* pn) const
+      {
+        return static_cast<uint32_t>(pn - m_nodes.data());
+      }
+
+      //------------------------------------------------------------------------------------------------------------------
+      // lookup
+      bool key_equals(const node& key, const std::string& name) const
+      {
+        if (!key.has_escapes)
+          return key.length == name.size() && m_buff.compare(key.offset + 1, key.length, name) == 0;
+        return get_string(key) == name;
+      }
+
+      const node* find_value(const std::string& name, hsection hparent_section) const
+      {
+        const node* psec = hparent_section ? hparent_section : &m_nodes[1];
+        CHECK_AND_ASSERT_MES(psec->type == node_object, nullptr, "json_on_demand_reader: section handle is not an object");
+        for (uint32_t i = index_of(psec) + 1; i < psec->next; )
+        {
+          const node& key = m_nodes[i];
+          const node& val = m_nodes[i + 1];
+          if (key_equals(key, name))
+            return val.type == node_null ? nullptr : &val; // null is treated as absent value
+          i = val.next;
+        }
+        return nullptr;
+      }
+
+      std::string get_string(const node& n) const
+      {
+        if (!n.has_escapes)
+          return m_buff.substr(n.offset + 1, n.length);
+        std::string res;
+        std::string::const_iterator it = m_buff.begin() + n.offset;
+        misc_utils::parse::match_string2(it, m_buff.end(), res);
+        return res;
+      }
+
+      //------------------------------------------------------------------------------------------------------------------
+      // conversion, follows portable_storage::get_value() semantics
+      template<class t_value>
+      void node_to_value(const node& n, t_value& val) const
+      {
+        switch (n.type)
+        {
+        case node_string: convert_t(get_string(n), val); break;
+        case node_uint64: convert_t(n.v.u, val); break;
+        case node_int64:  convert_t(n.v.i, val); break;
+        case node_double: convert_t(n.v.d, val); break;
+        case node_bool:   convert_t(n.v.b, val); break;
+        default:
+          ASSERT_MES_AND_THROW("WRONG DATA CONVERSION: from json " << (n.type == node_object ? "object" : "array") << " to type " << typeid(t_value).name());
+        }
+      }
+
+      void node_to_value(const node& n, std::string& val) const
+      {
+        if (n.type == node_string && !n.has_escapes)
+          val.assign(m_buff, n.offset + 1, n.length);
+        else
+          node_to_value<std::string>(n, val);
+      }
+
+      storage_entry node_to_storage_entry(const node& n) const
+      {
+        switch (n.type)
+        {
+        case node_string: return storage_entry(get_string(n));
+        case node_uint64: return storage_entry(n.v.u);
+        case node_int64:  return storage_entry(n.v.i);
+        case node_double: return storage_entry(n.v.d);
+        case node_bool:   return storage_entry(n.v.b);
+        case node_object:
+        {
+          section s;
+          for (uint32_t i = index_of(&n) + 1; i < n.next; )
+          {
+            const node& val = m_nodes[i + 1];
+            if (val.type != node_null)
+              s.m_entries[get_string(m_nodes[i])] = node_to_storage_entry(val);
+            i = val.next;
+          }
+          return storage_entry(s);
+        }
+        case node_array:
+          return storage_entry(node_to_array_entry(n));
+        default:
+          return storage_entry(std::string());
+        }
+      }
+
+      template<class t_value>
+      array_entry make_array_entry(const node& n) const
+      {
+        array_entry_t<t_value> arr;
+        for (uint32_t i = index_of(&n) + 1; i < n.next; i = m_nodes[i].next)
+        {
+          t_value v = AUTO_VAL_INIT(v);
+          node_to_value(m_nodes[i], v);
+          arr.insert_next_value(v);
+        }
+        return array_entry(arr);
+      }
+
+      array_entry node_to_array_entry(const node& n) const
+      {
+        uint32_t first = index_of(&n) + 1;
+        if (first >= n.next)
+          return array_entry(array_entry_t<std::string>());
+        switch (m_nodes[first].type)
+        {
+        case node_string: return make_array_entry<std::string>(n);
+        case node_double: return make_array_entry<double>(n);
+        case node_bool:   return make_array_entry<bool>(n);
+        case node_uint64:
+        case node_int64:  return make_array_entry<int64_t>(n);
+        case node_object:
+        {
+          array_entry_t<section> arr;
+          for (uint32_t i = first; i < n.next; i = m_nodes[i].next)
+          {
+            storage_entry se = node_to_storage_entry(m_nodes[i]);
+            arr.insert_next_value(boost::get<section>(se));
+          }
+          return array_entry(arr);
+        }
+        default:
+          ASSERT_MES_AND_THROW("array of array not suppoerted yet");
+        }
+      }
+
+      //------------------------------------------------------------------------------------------------------------------
+      // parsing
+      void skip_spaces(size_t& pos) const
+      {
+        while (pos < m_buff.size() && isspace(static_cast<unsigned char>(m_buff[pos])))
+          ++pos;
+      }
+
+      char next_char(size_t& pos) const
+      {
+        skip_spaces(pos);
+        CHECK_AND_ASSERT_THROW_MES(pos < m_buff.size(), "json: unexpected end of document");
+        return m_buff[pos];
+      }
+
+      void parse_object(size_t& pos, size_t depth)
+      {
+        CHECK_AND_ASSERT_THROW_MES(depth < max_depth, "json: nesting is too deep");
+        size_t idx = m_nodes.size();
+        m_nodes.push_back(make_node(node_object));
+        ++pos; // '{'
+        if (next_char(pos) == '}')
+        {
+          ++pos;
+        }
+        else
+        {
+          for (;;)
+          {
+            CHECK_AND_ASSERT_THROW_MES(next_char(pos) == '"', "json: unexpected character at " << pos << ", name expected");
+            parse_string(pos);
+            CHECK_AND_ASSERT_THROW_MES(next_char(pos) == ':', "json: unexpected character at " << pos << ", ':' expected");
+            ++pos;
+            parse_value(pos, depth);
+            char c = next_char(pos);
+            ++pos;
+            if (c == '}')
+              break;
+            CHECK_AND_ASSERT_THROW_MES(c == ',', "json: unexpected character at " << pos - 1 << ", ',' or '}' expected");
+          }
+        }
+        m_nodes[idx].next = static_cast<uint32_t>(m_nodes.size());
+      }
+
+      void parse_array(size_t& pos, size_t depth)
+      {
+        CHECK_AND_ASSERT_THROW_MES(depth < max_depth, "json: nesting is too deep");
+        size_t idx = m_nodes.size();
+        m_nodes.push_back(make_node(node_array));
+        ++pos; // '['
+        if (next_char(pos) == ']')
+        {
+          ++pos;
+        }
+        else
+        {
+          for (;;)
+          {
+            parse_value(pos, depth);
+            char c = next_char(pos);
+            ++pos;
+            if (c == ']')
+              break;
+            CHECK_AND_ASSERT_THROW_MES(c == ',', "json: unexpected character at " << pos - 1 << ", ',' or ']' expected");
+          }
+        }
+        m_nodes[idx].next = static_cast<uint32_t>(m_nodes.size());
+      }
+
+      void parse_value(size_t& pos, size_t depth)
+      {
+        char c = next_char(pos);
+        if (c == '"')
+          parse_string(pos);
+        else if (c == '{')
+          parse_object(pos, depth + 1);
+        else if (c == '[')
+          parse_array(pos, depth + 1);
+        else if (isdigit(static_cast<unsigned char>(c)) || c == '-')
+          parse_number(pos);
+        else if (isalpha(static_cast<unsigned char>(c)))
+          parse_word(pos);
+        else
+          ASSERT_MES_AND_THROW("json: unexpected character at " << pos << ", value expected");
+      }
+
+      void parse_string(size_t& pos)
+      {
+        node n = make_node(node_string, static_cast<uint32_t>(m_nodes.size() + 1));
+        n.offset = pos;
+        size_t i = pos + 1;
+        for (; i < m_buff.size(); ++i)
+        {
+          char c = m_buff[i];
+          if (c == '"')
+            break;
+          if (c == '\\')
+          {
+            n.has_escapes = true;
+            ++i;
+          }
+        }
+        CHECK_AND_ASSERT_THROW_MES(i < m_buff.size(), "json: unterminated string at " << pos);
+        n.length = i - pos - 1;
+        pos = i + 1;
+        m_nodes.push_back(n);
+      }
+
+      // same number grammar as match_number2(): optional '-', digits, optional fraction and exponent after it
+      void parse_number(size_t& pos)
+      {
+        node n = make_node(node_uint64, static_cast<uint32_t>(m_nodes.size() + 1));
+        size_t start = pos;
+        bool is_signed = m_buff[pos] == '-';
+        bool is_float = false;
+        size_t i = is_signed ? pos + 1 : pos;
+        for (; i < m_buff.size(); ++i)
+        {
+          char c = m_buff[i];
+          if (isdigit(static_cast<unsigned char>(c)))
+            continue;
+          if (c == '.' && i != start)
+            is_float = true;
+          else if (!(is_float && (c == 'e' || c == 'E' || c == '-' || c == '+')))
+            break;
+        }
+        CHECK_AND_ASSERT_THROW_MES(i != (is_signed ? start + 1 : start), "json: wrong number at " << start);
+        CHECK_AND_ASSERT_THROW_MES(i < m_buff.size(), "json: unexpected end of document");
+        pos = i;
+
+        if (is_float)
+        {
+          std::string s = m_buff.substr(start, i - start);
+          char* p_end = nullptr;
+          n.v.d = strtod(s.c_str(), &p_end);
+          CHECK_AND_ASSERT_THROW_MES(p_end == s.c_str() + s.size(), "json: wrong number " << s);
+          n.type = node_double;
+        }
+        else
+        {
+          uint64_t u = 0;
+          for (size_t j = is_signed ? start + 1 : start; j != i; ++j)
+          {
+            uint64_t d = m_buff[j] - '0';
+            CHECK_AND_ASSERT_THROW_MES(u <= (UINT64_MAX - d) / 10, "json: number is out of range at " << start);
+            u = u * 10 + d;
+          }
+          if (is_signed)
+          {
+            CHECK_AND_ASSERT_THROW_MES(u <= static_cast<uint64_t>(INT64_MAX) + 1, "json: number is out of range at " << start);
+            n.v.i = static_cast<int64_t>(0 - u);
+            n.type = node_int64;
+          }
+          else
+          {
+            n.v.u = u;
+          }
+        }
+        m_nodes.push_back(n);
+      }
+
+      void parse_word(size_t& pos)
+      {
+        size_t start = pos;
+        while (pos < m_buff.size() && isalpha(static_cast<unsigned char>(m_buff[pos])))
+          ++pos;
+        CHECK_AND_ASSERT_THROW_MES(pos < m_buff.size(), "json: unexpected end of document");
+        std::string word = m_buff.substr(start, pos - start);
+        node n = make_node(node_bool, static_cast<uint32_t>(m_nodes.size() + 1));
+        if (boost::iequals(word, "true"))
+          n.v.b = true;
+        else if (boost::iequals(word, "false"))
+          n.v.b = false;
+        else if (boost::iequals(word, "null"))
+          n.type = node_null;
+        else
+          ASSERT_MES_AND_THROW("Unknown value keyword " << word);
+        m_nodes.push_back(n);
+      }
+
+      std::string m_buff;
+      std::vector<node> m_nodes;
+    };
+  }
+}
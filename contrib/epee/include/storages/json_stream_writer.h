@@ -0,0 +1,237 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstdio>
+#include <deque>
+#include <sstream>
+#include <string>
+#include "misc_log_ex.h"
+#include "parserse_base_utils.h"
+#include "portable_storage_base.h"
+#include "portable_storage_to_json.h"
+
+namespace epee
+{
+  namespace serialization
+  {
+    /************************************************************************/
+    /* Write-only storage for KV serialization (BEGIN_KV_SERIALIZE_MAP)     */
+    /* that appends JSON text as store() visits the fields.                 */
+    /*                                                                      */
+    /* Layout is the same as dump_as_json() of portable_storage, but keys   */
+    /* go in declaration order rather than sorted. Don't use it where the   */
+    /* exact text matters (e.g. it gets hashed), use store_t_to_json().     */
+    /*                                                                      */
+    /* store() is depth-first, so the writer keeps a stack of open objects  */
+    /* and arrays; writing into a handle closes everything above it.        */
+    /************************************************************************/
+    class json_stream_writer
+    {
+      struct scope
+      {
+        size_t level;     // position in the stack
+        size_t indent;    // object: indent of its closing brace; array: indent of objects inside it
+        size_t items;
+        bool is_array;
+      };
+
+    public:
+      typedef scope* hsection;
+      typedef scope* harray;
+      typedef storage_entry meta_entry;
+
+      explicit json_stream_writer(std::string& target, size_t indent = 0, end_of_line_t eol = eol_crlf)
+        : m_target(target)
+        , m_eol(eol)
+      {
+        m_target.clear();
+        push_scope(false, indent);
+        m_target += '{';
+        put_eol();
+      }
+
+      // closes all open objects and arrays; nothing can be written afterwards
+      void finish()
+      {
+        if (m_stack.empty())
+          return;
+        close_scopes_above(0);
+        close_top();
+      }
+
+      hsection open_section(const std::string& section_name, hsection hparent_section, bool /*create_if_notexist*/ = true)
+      {
+        scope& parent = begin_entry(section_name, hparent_section);
+        return open_object(parent.indent + 1);
+      }
+
+      template<class t_value>
+      bool set_value(const std::string& value_name, const t_value& v, hsection hparent_section)
+      {
+        scope& parent = begin_entry(value_name, hparent_section);
+        write_value(v, parent.indent + 1);
+        return true;
+      }
+
+      template<class t_value>
+      harray insert_first_value(const std::string& value_name, const t_value& v, hsection hparent_section)
+      {
+        scope& parent = begin_entry(value_name, hparent_section);
+        harray ha = open_array(parent.indent + 1);
+        insert_next_value(ha, v);
+        return ha;
+      }
+
+      template<class t_value>
+      bool insert_next_value(harray hval_array, const t_value& v)
+      {
+        begin_array_item(hval_array);
+        write_value(v, hval_array->indent);
+        return true;
+      }
+
+      harray insert_first_section(const std::string& sec_name, hsection& hinserted_childsection, hsection hparent_section)
+      {
+        scope& parent = begin_entry(sec_name, hparent_section);
+        harray ha = open_array(parent.indent + 1);
+        insert_next_section(ha, hinserted_childsection);
+        return ha;
+      }
+
+      bool insert_next_section(harray hsec_array, hsection& hinserted_childsection)
+      {
+        begin_array_item(hsec_array);
+        hinserted_childsection = open_object(hsec_array->indent);
+        return true;
+      }
+
+    private:
+      void put_eol()
+      {
+        switch (m_eol)
+        {
+        case eol_lf:    m_target += '\n';   break;
+        case eol_cr:    m_target += '\r';   break;
+        case eol_space: m_target += ' ';    break;
+        default:        m_target += "\r\n"; break;
+        }
+      }
+
+      void put_indent(size_t indent)
+      {
+        m_target.append(indent * 2, ' ');
+      }
+
+      scope* push_scope(bool is_array, size_t indent)
+      {
+        scope s = { m_stack.size(), indent, 0, is_array };
+        m_stack.push_back(s);
+        return &m_stack.back();
+      }
+
+      void close_top()
+      {
+        scope& s = m_stack.back();
+        if (s.is_array)
+        {
+          m_target += ']';
+        }
+        else
+        {
+          if (s.items)
+            put_eol();
+          put_indent(s.indent);
+          m_target += '}';
+        }
+        m_stack.pop_back();
+      }
+
+      void close_scopes_above(size_t level)
+      {
+        while (m_stack.size() > level + 1)
+          close_top();
+      }
+
+      scope& activate(scope* ps)
+      {
+        CHECK_AND_ASSERT_THROW_MES(ps->level < m_stack.size() && &m_stack[ps->level] == ps, "json_stream_writer: handle of already closed scope");
+        close_scopes_above(ps->level);
+        return *ps;
+      }
+
+      scope& begin_entry(const std::string& name, hsection hparent_section)
+      {
+        scope& parent = activate(hparent_section ? hparent_section : &m_stack.front());
+        CHECK_AND_ASSERT_THROW_MES(!parent.is_array, "json_stream_writer: named entry inside array");
+        if (parent.items++)
+        {
+          m_target += ',';
+          put_eol();
+        }
+        put_indent(parent.indent + 1);
+        m_target += '"';
+        m_target += misc_utils::parse::transform_to_json_escape_sequence(name);
+        m_target += "\": ";
+        return parent;
+      }
+
+      void begin_array_item(harray ha)
+      {
+        scope& arr = activate(ha);
+        CHECK_AND_ASSERT_THROW_MES(arr.is_array, "json_stream_writer: array handle expected");
+        if (arr.items++)
+          m_target += ',';
+      }
+
+      hsection open_object(size_t indent)
+      {
+        m_target += '{';
+        put_eol();
+        return push_scope(false, indent);
+      }
+
+      harray open_array(size_t indent)
+      {
+        m_target += '[';
+        return push_scope(true, indent);
+      }
+
+      //------------------------------------------------------------------------------------------------------------------
+      // values, formatted as dump_as_json() does
+      void write_value(const std::string& v, size_t /*indent*/)
+      {
+        m_target += '"';
+        m_target += misc_utils::parse::transform_to_json_escape_sequence(v);
+        m_target += '"';
+      }
+      void write_value(const bool& v, size_t /*indent*/)    { m_target += v ? "true" : "false"; }
+      void write_value(const int8_t& v, size_t /*indent*/)  { m_target += std::to_string(static_cast<int32_t>(v)); }
+      void write_value(const uint8_t& v, size_t /*indent*/) { m_target += std::to_string(static_cast<int32_t>(v)); }
+      void write_value(const int16_t& v, size_t /*indent*/) { m_target += std::to_string(v); }
+      void write_value(const uint16_t& v, size_t /*indent*/) { m_target += std::to_string(v); }
+      void write_value(const int32_t& v, size_t /*indent*/) { m_target += std::to_string(v); }
+      void write_value(const uint32_t& v, size_t /*indent*/) { m_target += std::to_string(v); }
+      void write_value(const int64_t& v, size_t /*indent*/) { m_target += std::to_string(v); }
+      void write_value(const uint64_t& v, size_t /*indent*/) { m_target += std::to_string(v); }
+      void write_value(const double& v, size_t /*indent*/)
+      {
+        char buff[400];
+        snprintf(buff, sizeof(buff), "%.8f", v);
+        m_target += buff;
+      }
+      void write_value(const storage_entry& v, size_t indent)
+      {
+        std::stringstream ss;
+        dump_as_json(ss, v, indent, m_eol);
+        m_target += ss.str();
+      }
+
+      std::string& m_target;
+      end_of_line_t m_eol;
+      std::deque<scope> m_stack; // deque keeps handles valid while the stack grows
+    };
+  }
+}
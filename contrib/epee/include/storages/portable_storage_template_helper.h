@@ -27,6 +27,10 @@
 #pragma once
 #include "parserse_base_utils.h"
 #include "portable_storage.h"
+#include "json_on_demand_reader.h"
+#include "json_stream_writer.h"
+#include "binary_on_demand_reader.h"
+#include "binary_flat_writer.h"
 #include "file_io_utils.h"
 
 namespace epee
@@ -45,6 +49,17 @@ namespace epee
       return out.load(ps);
     }
     //-----------------------------------------------------------------------------------------------------------
+    // same as load_t_from_json(), but without building portable_storage in between
+    template<class t_struct>
+    bool load_t_from_json_on_demand(t_struct& out, const std::string& json_buff)
+    {
+      json_on_demand_reader reader;
+      if(!reader.load_from_json(json_buff))
+        return false;
+
+      return out.load(reader);
+    }
+    //-----------------------------------------------------------------------------------------------------------
     template<class t_struct>
     bool load_t_from_json_file(t_struct& out, const std::string& json_file)
     {
@@ -72,6 +87,16 @@ namespace epee
       return json_buff;
     }
     //-----------------------------------------------------------------------------------------------------------
+    // same layout as store_t_to_json(), but keys are not sorted (see json_stream_writer)
+    template<class t_struct>
+    bool store_t_to_json_stream(const t_struct& str_in, std::string& json_buff, size_t indent = 0, end_of_line_t eol = eol_crlf)
+    {
+      json_stream_writer writer(json_buff, indent, eol);
+      str_in.store(writer);
+      writer.finish();
+      return true;
+    }
+    //-----------------------------------------------------------------------------------------------------------
     template<class t_struct>
     bool store_t_to_json_file(const t_struct& str_in, const std::string& fpath)
     {
@@ -80,15 +105,15 @@ namespace epee
       return file_io_utils::save_string_to_file(fpath, json_buff);
     }
     //-----------------------------------------------------------------------------------------------------------
+    // reads the buffer in place (see binary_on_demand_reader), result is the same as through portable_storage
     template<class t_struct>
     bool load_t_from_binary(t_struct& out, const std::string& binary_buff)
     {
-      portable_storage ps;
-      bool rs = ps.load_from_binary(binary_buff);
-      if(!rs)
+      binary_on_demand_reader reader;
+      if(!reader.load_from_binary(binary_buff))
         return false;
 
-      return out.load(ps);
+      return out.load(reader);
     }
     //-----------------------------------------------------------------------------------------------------------
     template<class t_struct>
@@ -103,12 +128,13 @@ namespace epee
     //-----------------------------------------------------------------------------------------------------------
 PUSH_VS_WARNINGS
 DISABLE_VS_WARNINGS(4100)
+    // same bytes as portable_storage::store_to_binary() gives (see binary_flat_writer)
     template<class t_struct>
     bool store_t_to_binary(const t_struct& str_in, std::string& binary_buff, size_t indent = 0)
     {
-      portable_storage ps;
-      str_in.store(ps);
-      return ps.store_to_binary(binary_buff);
+      binary_flat_writer writer;
+      str_in.store(writer);
+      return writer.store_to_binary(binary_buff);
     }
 POP_VS_WARNINGS
     //-----------------------------------------------------------------------------------------------------------
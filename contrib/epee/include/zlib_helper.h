@@ -62,6 +62,31 @@ namespace zlib_helper
 		return true;
 	}
 
+	// HTTP "Content-Encoding: gzip" or "deflate" (zlib stream, RFC 1950) body, fastest level as it's done per response
+	inline 	bool pack_http_content(const std::string& target, std::string& result_packed_buff, bool gzip_format)
+	{
+		result_packed_buff.clear();
+
+		z_stream    zstream = {0};
+		int ret = deflateInit2(&zstream, Z_BEST_SPEED, Z_DEFLATED, gzip_format ? MAX_WBITS + 16 : MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+		CHECK_AND_ASSERT_MES(ret == Z_OK, false, "Failed to init deflate. err = " << ret);
+
+		size_t estimated_output_size_max = deflateBound(&zstream, static_cast<uLong>(target.size())) + 18; // deflateBound() may not count gzip wrapper
+		result_packed_buff.resize(estimated_output_size_max);
+
+		zstream.next_in = (Bytef*)target.data();
+		zstream.avail_in = (uInt)target.size();
+		zstream.next_out = (Bytef*)result_packed_buff.data();
+		zstream.avail_out = (uInt)result_packed_buff.size();
+
+		ret = deflate(&zstream, Z_FINISH);
+		deflateEnd(&zstream);
+		CHECK_AND_ASSERT_MES(ret == Z_STREAM_END, false, "Failed to deflate. err = " << ret);
+
+		result_packed_buff.resize(result_packed_buff.size() - zstream.avail_out);
+		return true;
+	}
+
 	inline 	bool pack(std::string& target)
 	{
 		std::string result_packed_buff;
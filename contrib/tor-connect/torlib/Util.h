@@ -96,7 +96,7 @@
 #include <boost/asio/ssl.hpp>
 #include <boost/format.hpp>
 
-using namespace boost::placeholders
+using namespace boost::placeholders;
 
 typedef uint8_t u8;
 typedef uint16_t u16;
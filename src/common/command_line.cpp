@@ -22,6 +22,7 @@ namespace command_line
   const arg_descriptor<std::string> arg_log_dir       ( "log-dir", "");
   const arg_descriptor<std::string> arg_log_file      ( "log-file", "", "");
   const arg_descriptor<int>         arg_log_level     ( "log-level", "");
+  const arg_descriptor<bool>        arg_log_async     ( "log-async", "Write logs from a background thread, messages are dropped (and counted) if it can't keep up");
 
   const arg_descriptor<bool>        arg_console       ( "no-console", "Disable daemon console commands" );
   const arg_descriptor<bool>        arg_show_details  ( "currency-details", "Display currency details" );
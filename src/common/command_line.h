@@ -218,6 +218,7 @@ namespace command_line
   extern const arg_descriptor<std::string> arg_log_dir;
   extern const arg_descriptor<std::string> arg_log_file;
   extern const arg_descriptor<int>         arg_log_level;
+  extern const arg_descriptor<bool>        arg_log_async;
   extern const arg_descriptor<bool>        arg_console;
   extern const arg_descriptor<bool>        arg_show_details;
   extern const arg_descriptor<bool>        arg_show_rpc_autodoc;
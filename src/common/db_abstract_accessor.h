@@ -65,8 +65,14 @@ namespace tools
     /************************************************************************/
     /*                                                                      */
     /************************************************************************/
-    class basic_db_accessor
+    class basic_db_accessor : public epee::misc_utils::i_isolation_reader_check
     {
+      struct read_snapshot_entry
+      {
+        uint64_t commit_generation;   // m_commit_generation when snapshot was taken
+        size_t depth;
+      };
+
       std::shared_ptr<i_db_backend> m_backend;
       epee::critical_section m_binded_containers_lock;
       std::set<i_db_parent_to_container_callabck*> m_binded_containers;
@@ -75,22 +81,26 @@ namespace tools
       std::map<std::thread::id, std::vector<bool> > m_transactions_stack;
       std::atomic<bool> m_is_open;
       epee::shared_recursive_mutex& m_rwlock;
+      std::atomic<uint64_t> m_commit_generation;  // count of committed write transactions
+      mutable epee::critical_section m_read_snapshots_lock;
+      mutable std::map<std::thread::id, read_snapshot_entry> m_read_snapshots;
+      mutable std::atomic<size_t> m_read_snapshots_count;
     public:      
       struct performance_data
       {
-        epee::math_helper::average<uint64_t, 10> backend_set_pod_time;
-        epee::math_helper::average<uint64_t, 10> backend_set_t_time;
-        epee::math_helper::average<uint64_t, 10> set_serialize_t_time;
-        epee::math_helper::average<uint64_t, 10> backend_get_pod_time;
-        epee::math_helper::average<uint64_t, 10> backend_get_t_time;
-        epee::math_helper::average<uint64_t, 10> get_serialize_t_time;
+        epee::math_helper::average_with_histogram<uint64_t, 10> backend_set_pod_time;
+        epee::math_helper::average_with_histogram<uint64_t, 10> backend_set_t_time;
+        epee::math_helper::average_with_histogram<uint64_t, 10> set_serialize_t_time;
+        epee::math_helper::average_with_histogram<uint64_t, 10> backend_get_pod_time;
+        epee::math_helper::average_with_histogram<uint64_t, 10> backend_get_t_time;
+        epee::math_helper::average_with_histogram<uint64_t, 10> get_serialize_t_time;
       };
     private:
       mutable performance_data m_gperformance_data;
       mutable std::unordered_map<container_handle, performance_data> m_performance_data_map;
     public:
       basic_db_accessor(std::shared_ptr<i_db_backend> backend, epee::shared_recursive_mutex& rwlock)
-        : m_backend(backend), m_rwlock(rwlock), m_is_open(false)
+        : m_backend(backend), m_rwlock(rwlock), m_is_open(false), m_commit_generation(0), m_read_snapshots_count(0)
       {
       }
 
@@ -129,6 +139,7 @@ namespace tools
       }
       bool begin_transaction(bool readonly = false)
       {
+        TRACE_SPAN_COND(!readonly, "db::begin_write_transaction");
         bool r = m_backend->begin_transaction(readonly);
         CRITICAL_REGION_LOCAL(m_transactions_stack_lock);
         std::vector<bool>& this_thread_tx_stack = m_transactions_stack[std::this_thread::get_id()];
@@ -168,6 +179,7 @@ namespace tools
           CHECK_AND_ASSERT_THROW_MES(this_thread_tx_stack.size(), "Internal error: this_thread_tx_stack.size = 0 at commit tx");
           is_writer_tx = !this_thread_tx_stack.back();
         }
+        TRACE_SPAN_COND(is_writer_tx, "db::commit_write_transaction");
 
         if (is_writer_tx)
           m_rwlock.lock(); // wait all readers and writers to get exclusive access
@@ -183,6 +195,7 @@ namespace tools
           bool has_other_writers_on_stack = has_writer_tx_in_stack(this_thread_tx_stack);
           if (is_writer_tx && !has_other_writers_on_stack)
           {
+            ++m_commit_generation; // before caches get shared, so readers of older snapshots stay off them
             LOG_PRINT_CYAN("[WRITE_TX_COMMIT]", LOG_LEVEL_2);
             for (auto cnt_ptr : m_binded_containers)
             {
@@ -206,6 +219,7 @@ namespace tools
           CHECK_AND_ASSERT_THROW_MES(!this_thread_tx_stack.back(), "Internal error: abort on readonly tx");
           is_writer_tx = !this_thread_tx_stack.back();
         }
+        TRACE_SPAN_COND(is_writer_tx, "db::abort_write_transaction");
         if (is_writer_tx)
           m_rwlock.lock(); // wait all readers and writers to get exclusive access
 
@@ -233,6 +247,70 @@ namespace tools
 
       }
 
+      /*
+      Read snapshot: this thread reads db as it was committed at begin_read_snapshot() (read-only transaction, which
+      is MVCC snapshot in lmdb/mdbx) until end_read_snapshot(), no matter what writers commit meanwhile.
+      Containers' caches serve it only while nothing is committed after the snapshot was taken.
+      Has to be the outermost transaction of the thread, and the thread must not write until it's over.
+      */
+      void begin_read_snapshot() const
+      {
+        // taken before the transaction, so it's never newer than the snapshot itself
+        uint64_t commit_generation = m_commit_generation;
+        {
+          CRITICAL_REGION_LOCAL(m_read_snapshots_lock);
+          auto it = m_read_snapshots.find(std::this_thread::get_id());
+          if (it != m_read_snapshots.end())
+          {
+            ++it->second.depth;
+            return;
+          }
+        }
+        {
+          basic_db_accessor& self = const_cast<basic_db_accessor&>(*this);
+          CRITICAL_REGION_LOCAL(self.m_transactions_stack_lock);
+          auto it = self.m_transactions_stack.find(std::this_thread::get_id());
+          CHECK_AND_ASSERT_THROW_MES(it == self.m_transactions_stack.end() || it->second.empty(), "read snapshot can't be started inside other transaction");
+        }
+        CHECK_AND_ASSERT_THROW_MES(begin_readonly_transaction(), "failed to begin read snapshot transaction");
+        CRITICAL_REGION_LOCAL(m_read_snapshots_lock);
+        read_snapshot_entry& rse = m_read_snapshots[std::this_thread::get_id()];
+        rse.commit_generation = commit_generation;
+        rse.depth = 1;
+        ++m_read_snapshots_count;
+      }
+
+      void end_read_snapshot() const
+      {
+        {
+          CRITICAL_REGION_LOCAL(m_read_snapshots_lock);
+          auto it = m_read_snapshots.find(std::this_thread::get_id());
+          CHECK_AND_ASSERT_THROW_MES(it != m_read_snapshots.end(), "end_read_snapshot() without begin_read_snapshot()");
+          if (--it->second.depth)
+            return;
+          m_read_snapshots.erase(it);
+          --m_read_snapshots_count;
+        }
+        commit_transaction();
+      }
+
+      bool is_in_read_snapshot() const
+      {
+        if (!m_read_snapshots_count)
+          return false;
+        CRITICAL_REGION_LOCAL(m_read_snapshots_lock);
+        return m_read_snapshots.count(std::this_thread::get_id()) != 0;
+      }
+
+      // epee::misc_utils::i_isolation_reader_check
+      virtual bool is_cache_allowed_for_reader() const override
+      {
+        if (!m_read_snapshots_count)
+          return true;
+        CRITICAL_REGION_LOCAL(m_read_snapshots_lock);
+        auto it = m_read_snapshots.find(std::this_thread::get_id());
+        return it == m_read_snapshots.end() || it->second.commit_generation == m_commit_generation;
+      }
 
       std::shared_ptr<i_db_backend> get_backend() const 
       {
@@ -515,6 +593,7 @@ namespace tools
         size_cache_valid(false)
       {
         db.bind_parent_container(this);
+        m_isolation.set_reader_check(&db);
       }
 
       ~basic_key_value_accessor()
@@ -1065,6 +1144,32 @@ namespace tools
 
     };
 
+    /************************************************************************/
+    /*                                                                      */
+    /************************************************************************/
+    /************************************************************************/
+    /* Shared membership of the lock writers take exclusively to commit.    */
+    /* Threads in read snapshot skip it, commits don't change what they see */
+    /************************************************************************/
+    class snapshot_aware_shared_membership
+    {
+      epee::shared_recursive_mutex& m_mutex;
+      const basic_db_accessor& m_db;
+    public:
+      snapshot_aware_shared_membership(epee::shared_recursive_mutex& m, const basic_db_accessor& db) : m_mutex(m), m_db(db)
+      {}
+      void lock()
+      {
+        if (!m_db.is_in_read_snapshot())
+          m_mutex.lock_shared();
+      }
+      void unlock()
+      {
+        if (!m_db.is_in_read_snapshot())
+          m_mutex.unlock_shared();
+      }
+    };
+
     /************************************************************************/
     /*                                                                      */
     /************************************************************************/
@@ -1100,5 +1205,16 @@ namespace tools
   }
 }
 
+namespace epee
+{
+  template<>
+  class guarded_critical_region_t<tools::db::snapshot_aware_shared_membership> : public critical_region_t<tools::db::snapshot_aware_shared_membership>
+  {
+  public:
+    guarded_critical_region_t(tools::db::snapshot_aware_shared_membership& cs, const char* /*func_name*/, const char* /*location*/, const char* /*lock_name*/, const std::string& /*thread_name*/) : critical_region_t<tools::db::snapshot_aware_shared_membership>(cs)
+    {}
+  };
+}
+
 #undef LOG_DEFAULT_CHANNEL 
 #define LOG_DEFAULT_CHANNEL NULL
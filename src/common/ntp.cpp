@@ -20,7 +20,7 @@
 #include <chrono>
 #include "ntp.h"
 
-using namespace boost::placeholders
+using namespace boost::placeholders;
 
 using boost::asio::deadline_timer;
 using boost::asio::ip::udp;
@@ -58,6 +58,9 @@ using namespace currency;
 #define BLOCKCHAIN_STORAGE_CONTAINER_ADDR_TO_ALIAS    "addr_to_alias"
 #define BLOCKCHAIN_STORAGE_CONTAINER_TX_FEE_MEDIAN    "median_fee2"
 #define BLOCKCHAIN_STORAGE_CONTAINER_GINDEX_INCS      "gindex_increments"
+#define BLOCKCHAIN_STORAGE_CONTAINER_SPENT_FLAGS      "spent_flags"
+#define BLOCKCHAIN_STORAGE_CONTAINER_TX_SIGNATURES    "tx_signatures"
+#define BLOCKCHAIN_STORAGE_CONTAINER_TX_ATTACHMENTS   "tx_attachments"
 
 #define BLOCKCHAIN_STORAGE_OPTIONS_ID_CURRENT_BLOCK_CUMUL_SZ_LIMIT          0
 #define BLOCKCHAIN_STORAGE_OPTIONS_ID_CURRENT_PRUNED_RS_HEIGHT              1
@@ -65,8 +68,15 @@ using namespace currency;
 #define BLOCKCHAIN_STORAGE_OPTIONS_ID_STORAGE_MAJOR_COMPATIBILITY_VERSION   3 //DON'T CHANGE THIS, if you need to resync db change BLOCKCHAIN_STORAGE_MAJOR_COMPATIBILITY_VERSION
 #define BLOCKCHAIN_STORAGE_OPTIONS_ID_STORAGE_MINOR_COMPATIBILITY_VERSION   4 //mismatch here means some reinitializations
 
+#define BLOCKCHAIN_STORAGE_MINOR_VERSION_SEPARATE_SPENT_FLAGS               2 //DBs with lower minor version keep spent flags in transactions container and get migrated
+// minor version 3: signatures and attachments of new txs are stored apart from transactions container (entries written before are read as is),
+// so older code must not open such DB
+
 #define TARGETDATA_CACHE_SIZE                          DIFFICULTY_WINDOW + 10
 
+#define BLOCKCHAIN_STORAGE_PRUNING_BATCH_TXS_DEFAULT   1000   // max txs pruned in one DB write transaction
+#define BLOCKCHAIN_STORAGE_PRUNING_BATCH_MS_DEFAULT    50     // max time spent in one DB write transaction
+
 #ifndef TESTNET
 #define BLOCKCHAIN_HEIGHT_FOR_POS_STRICT_SEQUENCE_LIMITATION          57000
 #else
@@ -82,6 +92,8 @@ namespace
 {
   const command_line::arg_descriptor<uint32_t>      arg_db_cache_l1  ( "db-cache-l1", "Specify size of memory mapped db cache file");
   const command_line::arg_descriptor<uint32_t>      arg_db_cache_l2  ( "db-cache-l2", "Specify cached elements in db helpers");
+  const command_line::arg_descriptor<uint32_t>      arg_db_pruning_batch_txs  ( "db-pruning-batch-txs", "Max number of transactions pruned in one DB transaction", BLOCKCHAIN_STORAGE_PRUNING_BATCH_TXS_DEFAULT);
+  const command_line::arg_descriptor<uint32_t>      arg_db_pruning_batch_ms   ( "db-pruning-batch-ms", "Max time (ms) spent on pruning in one DB transaction", BLOCKCHAIN_STORAGE_PRUNING_BATCH_MS_DEFAULT);
 }
 
 //------------------------------------------------------------------
@@ -89,13 +101,16 @@ blockchain_storage::blockchain_storage(tx_memory_pool& tx_pool) :m_db(nullptr, m
                                                                  m_db_blocks(m_db),
                                                                  m_db_blocks_index(m_db),
                                                                  m_db_transactions(m_db),
+                                                                 m_db_spent_flags(m_db),
+                                                                 m_db_tx_signatures(m_db),
+                                                                 m_db_tx_attachments(m_db),
                                                                  m_db_spent_keys(m_db),
                                                                  m_db_outputs(m_db),
                                                                  m_db_multisig_outs(m_db),
                                                                  m_db_solo_options(m_db),
                                                                  m_db_aliases(m_db),
                                                                  m_db_addr_to_alias(m_db), 
-                                                                 m_read_lock(m_rw_lock),
+                                                                 m_read_lock(m_rw_lock, m_db),
                                                                  m_db_current_block_cumul_sz_limit(BLOCKCHAIN_STORAGE_OPTIONS_ID_CURRENT_BLOCK_CUMUL_SZ_LIMIT, m_db_solo_options),
                                                                  m_db_current_pruned_rs_height(BLOCKCHAIN_STORAGE_OPTIONS_ID_CURRENT_PRUNED_RS_HEIGHT, m_db_solo_options),
                                                                  m_db_last_worked_version(BLOCKCHAIN_STORAGE_OPTIONS_ID_LAST_WORKED_VERSION, m_db_solo_options),
@@ -105,6 +120,9 @@ blockchain_storage::blockchain_storage(tx_memory_pool& tx_pool) :m_db(nullptr, m
                                                                  m_tx_pool(tx_pool), 
                                                                  m_is_in_checkpoint_zone(false), 
                                                                  m_is_blockchain_storing(false), 
+                                                                 m_pruning_batch_txs(BLOCKCHAIN_STORAGE_PRUNING_BATCH_TXS_DEFAULT),
+                                                                 m_pruning_batch_ms(BLOCKCHAIN_STORAGE_PRUNING_BATCH_MS_DEFAULT),
+                                                                 m_pruning_session_txs(0),
                                                                  m_core_runtime_config(get_default_core_runtime_config()),
                                                                  //m_bei_stub(AUTO_VAL_INIT(m_bei_stub)),
                                                                  m_event_handler(&m_event_handler_stub), 
@@ -147,8 +165,8 @@ bool blockchain_storage::have_tx_keyimg_as_spent(const crypto::key_image &key_im
 std::shared_ptr<transaction> blockchain_storage::get_tx(const crypto::hash &id) const
 {
   CRITICAL_REGION_LOCAL(m_read_lock);
-  auto it = m_db_transactions.find(id);
-  if (it == m_db_transactions.end())
+  auto it = get_full_tx_chain_entry(id);
+  if (!it)
     return std::shared_ptr<transaction>(nullptr);
   
   return std::make_shared<transaction>(it->tx);
@@ -158,6 +176,8 @@ void blockchain_storage::init_options(boost::program_options::options_descriptio
 {
   command_line::add_arg(desc, arg_db_cache_l1);
   command_line::add_arg(desc, arg_db_cache_l2);
+  command_line::add_arg(desc, arg_db_pruning_batch_txs);
+  command_line::add_arg(desc, arg_db_pruning_batch_ms);
 }
 //------------------------------------------------------------------
 uint64_t blockchain_storage::get_block_h_older_then(uint64_t timestamp) const 
@@ -282,6 +302,17 @@ bool blockchain_storage::init(const std::string& config_folder, const boost::pro
     CHECK_AND_ASSERT_MES(res, false, "Unable to init db container");
     res = m_db_per_block_gindex_incs.init(BLOCKCHAIN_STORAGE_CONTAINER_GINDEX_INCS);
     CHECK_AND_ASSERT_MES(res, false, "Unable to init db container");
+    res = m_db_spent_flags.init(BLOCKCHAIN_STORAGE_CONTAINER_SPENT_FLAGS);
+    CHECK_AND_ASSERT_MES(res, false, "Unable to init db container");
+    res = m_db_tx_signatures.init(BLOCKCHAIN_STORAGE_CONTAINER_TX_SIGNATURES);
+    CHECK_AND_ASSERT_MES(res, false, "Unable to init db container");
+    res = m_db_tx_attachments.init(BLOCKCHAIN_STORAGE_CONTAINER_TX_ATTACHMENTS);
+    CHECK_AND_ASSERT_MES(res, false, "Unable to init db container");
+
+    if (command_line::has_arg(vm, arg_db_pruning_batch_txs))
+      m_pruning_batch_txs = std::max<uint64_t>(command_line::get_arg(vm, arg_db_pruning_batch_txs), 1);
+    if (command_line::has_arg(vm, arg_db_pruning_batch_ms))
+      m_pruning_batch_ms = std::max<uint64_t>(command_line::get_arg(vm, arg_db_pruning_batch_ms), 1);
 
     if (command_line::has_arg(vm, arg_db_cache_l2))
     {
@@ -291,6 +322,7 @@ bool blockchain_storage::init(const std::string& config_folder, const boost::pro
       m_db_blocks.set_cache_size(cache_size);
       m_db_blocks_index.set_cache_size(cache_size);
       m_db_transactions.set_cache_size(cache_size);
+      m_db_spent_flags.set_cache_size(cache_size);
       m_db_spent_keys.set_cache_size(cache_size);
       //m_db_outputs.set_cache_size(cache_size);
       m_db_multisig_outs.set_cache_size(cache_size);
@@ -400,6 +432,14 @@ bool blockchain_storage::init(const std::string& config_folder, const boost::pro
         need_reinit = true;
         LOG_PRINT_MAGENTA("DB storage needs reinit because it has minor compatibility ver " << m_db_storage_minor_compatibility_version << " that is greater than BLOCKCHAIN_STORAGE_MINOR_COMPATIBILITY_VERSION: " << BLOCKCHAIN_STORAGE_MINOR_COMPATIBILITY_VERSION, LOG_LEVEL_0);
       }
+      else if (m_db_storage_minor_compatibility_version < BLOCKCHAIN_STORAGE_MINOR_VERSION_SEPARATE_SPENT_FLAGS)
+      {
+        if (!migrate_spent_flags_to_separate_container())
+        {
+          need_reinit = true;
+          LOG_PRINT_MAGENTA("DB storage needs reinit because spent flags migration failed", LOG_LEVEL_0);
+        }
+      }
     }
 
     if (need_reinit)
@@ -408,6 +448,9 @@ bool blockchain_storage::init(const std::string& config_folder, const boost::pro
       m_db_blocks.deinit();
       m_db_blocks_index.deinit();
       m_db_transactions.deinit();
+      m_db_spent_flags.deinit();
+      m_db_tx_signatures.deinit();
+      m_db_tx_attachments.deinit();
       m_db_spent_keys.deinit();
       m_db_outputs.deinit();
       m_db_multisig_outs.deinit();
@@ -492,6 +535,50 @@ void blockchain_storage::store_db_solo_options_values()
   m_db.commit_transaction();
 }
 //------------------------------------------------------------------
+bool blockchain_storage::migrate_spent_flags_to_separate_container()
+{
+  LOG_PRINT_MAGENTA("Migrating DB: moving spent flags out of transactions container (minor ver " << m_db_storage_minor_compatibility_version << " -> " << BLOCKCHAIN_STORAGE_MINOR_COMPATIBILITY_VERSION << ")...", LOG_LEVEL_0);
+
+  typedef std::vector<std::pair<crypto::hash, tx_spent_flags>> tmp_container_t;
+  tmp_container_t temp_container;
+  uint64_t spent_outs_count = 0;
+  m_db_transactions.enumerate_items([&](uint64_t i, const crypto::hash& tx_id, const transaction_chain_entry& tce)
+  {
+    tx_spent_flags sf = AUTO_VAL_INIT(sf);
+    for (size_t n = 0; n != tce.m_spent_flags.size(); n++)
+    {
+      if (tce.m_spent_flags[n])
+      {
+        sf.set(n, true);
+        ++spent_outs_count;
+      }
+    }
+    if (!sf.empty())
+      temp_container.emplace_back(tx_id, sf);
+    return true;
+  });
+
+  // flags and minor version are committed together, so interrupted migration is simply repeated on the next launch
+  try
+  {
+    m_db.begin_transaction();
+    m_db_spent_flags.clear();
+    for (auto& el : temp_container)
+      m_db_spent_flags.set(el.first, el.second);
+    m_db_storage_minor_compatibility_version = BLOCKCHAIN_STORAGE_MINOR_COMPATIBILITY_VERSION;
+    m_db.commit_transaction();
+  }
+  catch (const std::exception& e)
+  {
+    m_db.abort_transaction();
+    LOG_ERROR("Migrating DB: exception while storing spent flags: " << e.what());
+    return false;
+  }
+
+  LOG_PRINT_MAGENTA("Migrating DB: successfully done, " << spent_outs_count << " spent outputs in " << temp_container.size() << " transactions", LOG_LEVEL_0);
+  return true;
+}
+//------------------------------------------------------------------
 bool blockchain_storage::deinit()
 {
   m_db.close();
@@ -502,6 +589,7 @@ bool blockchain_storage::deinit()
 //------------------------------------------------------------------
 bool blockchain_storage::pop_block_from_blockchain(transactions_map& onboard_transactions)
 {
+  TRACE_SPAN("bcs::pop_block_from_blockchain");
   CRITICAL_REGION_LOCAL(m_read_lock);
 
   CHECK_AND_ASSERT_MES(m_db_blocks.size() > 1, false, "pop_block_from_blockchain: can't pop from blockchain with size = " << m_db_blocks.size());
@@ -534,7 +622,6 @@ bool blockchain_storage::set_checkpoints(checkpoints&& chk_pts)
     m_db.begin_transaction();
     if (m_db_blocks.size() < m_checkpoints.get_top_checkpoint_height())
       m_is_in_checkpoint_zone = true;
-    prune_ring_signatures_and_attachments_if_need();
     m_db.commit_transaction();
     return true;
   }
@@ -553,7 +640,7 @@ bool blockchain_storage::set_checkpoints(checkpoints&& chk_pts)
   
 }
 //------------------------------------------------------------------
-bool blockchain_storage::prune_ring_signatures_and_attachments(uint64_t height, uint64_t& transactions_pruned, uint64_t& signatures_pruned, uint64_t& attachments_pruned)
+bool blockchain_storage::prune_ring_signatures_and_attachments(uint64_t height, uint64_t& transactions_pruned)
 {
   CRITICAL_REGION_LOCAL(m_read_lock);
 
@@ -571,14 +658,15 @@ bool blockchain_storage::prune_ring_signatures_and_attachments(uint64_t height,
       "failed to validate extra check, it->second.m_keeper_block_height = " << it->m_keeper_block_height  << 
       "is mot equal to height = " << height << " in blockchain index, for block on height = " << height);
     
-    transaction_chain_entry lolcal_chain_entry = *it;
-    signatures_pruned += lolcal_chain_entry.tx.signatures.size();
-    attachments_pruned += lolcal_chain_entry.tx.attachment.size();
-    lolcal_chain_entry.tx.signatures.clear();
-    lolcal_chain_entry.tx.attachment.clear();
-
-    //reassign to db
-    m_db_transactions.set(h, lolcal_chain_entry);
+    if (it->tx.signatures.size() || it->tx.attachment.size())
+    {
+      // stored in one piece by older version, have to rewrite it once
+      transaction_chain_entry lolcal_chain_entry = *it;
+      lolcal_chain_entry.tx.signatures.clear();
+      lolcal_chain_entry.tx.attachment.clear();
+      m_db_transactions.set(h, lolcal_chain_entry);
+    }
+    erase_tx_prunable_data(h);
 
     ++transactions_pruned;
   }
@@ -587,26 +675,78 @@ bool blockchain_storage::prune_ring_signatures_and_attachments(uint64_t height,
 //------------------------------------------------------------------
 bool blockchain_storage::prune_ring_signatures_and_attachments_if_need()
 {
-  CRITICAL_REGION_LOCAL(m_read_lock);
+  TRACE_SPAN("bcs::prune_ring_signatures_and_attachments_if_need");
+  // cheap check first, write transaction is not started (and block adding is not delayed) if there's nothing to do
+  if (get_pruning_target_height() <= get_pruned_rs_height())
+    return true;
 
-  uint64_t top_block_height = get_top_block_height();
-  uint64_t pruning_end_height = m_checkpoints.get_checkpoint_before_height(top_block_height);
-  if (pruning_end_height > m_db_current_pruned_rs_height)
+  // whole blocks only, pruned height is stored in the same DB transaction, so it's safe to stop at any moment and continue after restart
+  uint64_t tx_count = 0;
+  uint64_t height = 0;
+  uint64_t pruning_end_height = 0;
+  TIME_MEASURE_START_MS(batch_time);
+  try
   {
-    LOG_PRINT_CYAN("Starting pruning ring signatues and attachments from height " << m_db_current_pruned_rs_height + 1 << " to height " << pruning_end_height
-      << " (" << pruning_end_height - m_db_current_pruned_rs_height << " blocks), top block height is " << top_block_height, LOG_LEVEL_0);
-    uint64_t tx_count = 0, sig_count = 0, attach_count = 0;
-    for(uint64_t height = m_db_current_pruned_rs_height + 1; height <= pruning_end_height; height++)
+    m_db.begin_transaction();
+    CRITICAL_REGION_BEGIN(m_read_lock);
+    pruning_end_height = get_pruning_target_height();
+    height = m_db_current_pruned_rs_height;
+    if (m_pruning_session_txs == 0 && height < pruning_end_height)
     {
-      bool res = prune_ring_signatures_and_attachments(height, tx_count, sig_count, attach_count);
-      CHECK_AND_ASSERT_MES(res, false, "failed to prune_ring_signatures_and_attachments for height = " << height);
+      LOG_PRINT_CYAN("Starting pruning ring signatues and attachments from height " << height + 1 << " to height " << pruning_end_height
+        << " (" << pruning_end_height - height << " blocks), top block height is " << get_top_block_height(), LOG_LEVEL_0);
     }
-    m_db_current_pruned_rs_height = pruning_end_height;
-    LOG_PRINT_CYAN("Transaction pruning finished: " << sig_count << " signatures and " << attach_count << " attachments released in " << tx_count << " transactions.", LOG_LEVEL_0);
+    while (height < pruning_end_height && tx_count < m_pruning_batch_txs && epee::misc_utils::get_tick_count() - batch_time < m_pruning_batch_ms)
+    {
+      bool res = prune_ring_signatures_and_attachments(height + 1, tx_count);
+      CHECK_AND_ASSERT_THROW_MES(res, "failed to prune_ring_signatures_and_attachments for height = " << height + 1);
+      ++height;
+    }
+    m_db_current_pruned_rs_height = height;
+    CRITICAL_REGION_END();
+    m_db.commit_transaction();
+  }
+  catch (const std::exception& ex)
+  {
+    m_db.abort_transaction();
+    LOG_ERROR("Transaction pruning failed at height " << height + 1 << ": " << ex.what());
+    return false;
+  }
+  catch (...)
+  {
+    m_db.abort_transaction();
+    LOG_ERROR("Transaction pruning failed at height " << height + 1 << ": unknown exception");
+    return false;
+  }
+  TIME_MEASURE_FINISH_MS(batch_time);
+
+  m_pruning_session_txs += tx_count;
+  if (height >= pruning_end_height)
+  {
+    LOG_PRINT_CYAN("Transaction pruning finished: signatures and attachments released in " << m_pruning_session_txs << " transactions.", LOG_LEVEL_0);
+    m_pruning_session_txs = 0;
+  }
+  else
+  {
+    LOG_PRINT_L1("Transaction pruning: height " << height << " of " << pruning_end_height << ", " << tx_count << " txs pruned in " << batch_time << " ms");
   }
   return true;
 }
 //------------------------------------------------------------------
+uint64_t blockchain_storage::get_pruned_rs_height() const
+{
+  CRITICAL_REGION_LOCAL(m_read_lock);
+  return m_db_current_pruned_rs_height;
+}
+//------------------------------------------------------------------
+uint64_t blockchain_storage::get_pruning_target_height() const
+{
+  CRITICAL_REGION_LOCAL(m_read_lock);
+  if (!m_db_blocks.size())
+    return 0;
+  return m_checkpoints.get_checkpoint_before_height(get_top_block_height());
+}
+//------------------------------------------------------------------
 bool blockchain_storage::clear()
 {
   //CRITICAL_REGION_LOCAL(m_read_lock);
@@ -615,6 +755,9 @@ bool blockchain_storage::clear()
   m_db_blocks.clear();
   m_db_blocks_index.clear();
   m_db_transactions.clear();
+  m_db_spent_flags.clear();
+  m_db_tx_signatures.clear();
+  m_db_tx_attachments.clear();
   m_db_spent_keys.clear();
   m_db_solo_options.clear();
   store_db_solo_options_values();
@@ -722,8 +865,8 @@ bool blockchain_storage::purge_transaction_from_blockchain(const crypto::hash& t
   fee = 0;
   CRITICAL_REGION_LOCAL(m_read_lock);
 
-  auto tx_res_ptr = m_db_transactions.find(tx_id);
-  CHECK_AND_ASSERT_MES(tx_res_ptr != m_db_transactions.end(), false, "transaction " << tx_id << " is not found in blockchain index!!");
+  auto tx_res_ptr = get_full_tx_chain_entry(tx_id);
+  CHECK_AND_ASSERT_MES(tx_res_ptr, false, "transaction " << tx_id << " is not found in blockchain index!!");
   const transaction& tx = tx_res_ptr->tx;
   tx_ = tx;
 
@@ -747,6 +890,9 @@ bool blockchain_storage::purge_transaction_from_blockchain(const crypto::hash& t
   CHECK_AND_ASSERT_MES_NO_RET(res, "pop_transaction_from_global_index failed for tx " << tx_id);
   bool res_erase = m_db_transactions.erase_validate(tx_id);
   CHECK_AND_ASSERT_MES_NO_RET(res_erase, "Failed to m_transactions.erase with id = " << tx_id);
+  // outputs of a popped tx can only be spent by txs that were popped earlier, so normally there's nothing here
+  m_db_spent_flags.erase_validate(tx_id);
+  erase_tx_prunable_data(tx_id);
   
   LOG_PRINT_L1("transaction " << tx_id << (added_to_the_pool ? " was removed from blockchain history -> to the pool" : " was removed from blockchain history"));
   return res;
@@ -1006,6 +1152,7 @@ void blockchain_storage::do_erase_altblock(alt_chain_container::iterator it)
 //------------------------------------------------------------------
 bool blockchain_storage::switch_to_alternative_blockchain(alt_chain_type& alt_chain)
 {
+  TRACE_SPAN("bcs::switch_to_alternative_blockchain");
   CRITICAL_REGION_LOCAL(m_read_lock);
   CHECK_AND_ASSERT_MES(validate_blockchain_prev_links(), false, "EPIC FAIL!");
 
@@ -1607,6 +1754,7 @@ bool blockchain_storage::purge_altblock_keyimages_from_big_heap(const block& b,
 //------------------------------------------------------------------
 bool blockchain_storage::handle_alternative_block(const block& b, const crypto::hash& id, block_verification_context& bvc)
 {
+  TRACE_SPAN("bcs::handle_alternative_block");
   uint64_t coinbase_height = get_block_height(b);
   if (m_checkpoints.is_height_passed_zone(coinbase_height, get_top_block_height()))
   {
@@ -1695,7 +1843,7 @@ bool blockchain_storage::handle_alternative_block(const block& b, const crypto::
         if (!r)
         {
           //transaction could be in main chain 
-          auto tx_ptr = m_db_transactions.find(h);
+          auto tx_ptr = get_full_tx_chain_entry(h);
           if (!tx_ptr)
           {
             LOG_ERROR("Transaction " << h  << " for altblock " << get_block_hash(abei.bl) << " not found");
@@ -2067,7 +2215,7 @@ bool blockchain_storage::get_blocks(uint64_t start_offset, size_t count, std::li
 bool blockchain_storage::get_tx_rpc_details(const crypto::hash& h, tx_rpc_extended_info& tei, uint64_t timestamp, bool is_short) const
 {
   CRITICAL_REGION_LOCAL(m_read_lock);
-  auto tx_ptr = m_db_transactions.get(h);
+  auto tx_ptr = get_full_tx_chain_entry(h);
   if (!tx_ptr)
   {
     tei.keeper_block = -1; // tx is not confirmed yet, probably it's in the pool
@@ -2081,6 +2229,8 @@ bool blockchain_storage::get_tx_rpc_details(const crypto::hash& h, tx_rpc_extend
   }
   tei.keeper_block = static_cast<int64_t>(tx_ptr->m_keeper_block_height);
   fill_tx_rpc_details(tei, tx_ptr->tx, &(*tx_ptr), h, timestamp, is_short);
+  for (size_t i = 0; i != tei.outs.size(); i++)
+    tei.outs[i].is_spent = is_tx_output_spent(h, i);
   return true;
 }
 //------------------------------------------------------------------
@@ -2447,10 +2597,8 @@ bool blockchain_storage::add_out_to_get_random_outs(COMMAND_RPC_GET_RANDOM_OUTPU
   CHECK_AND_ASSERT_MES(tx.vout[out_ptr->out_no].target.type() == typeid(txout_to_key), false, "unknown tx out type");
   const txout_to_key& otk = boost::get<txout_to_key>(tx.vout[out_ptr->out_no].target);
 
-  CHECK_AND_ASSERT_MES(tx_ptr->m_spent_flags.size() == tx.vout.size(), false, "internal error");
-
   //do not use outputs that obviously spent for mixins
-  if (tx_ptr->m_spent_flags[out_ptr->out_no])
+  if (is_tx_output_spent(out_ptr->tx_id, out_ptr->out_no))
     return false;
 
   // do not use burned coins
@@ -2585,16 +2733,29 @@ bool blockchain_storage::update_spent_tx_flags_for_input(const crypto::hash& tx_
   CRITICAL_REGION_LOCAL(m_read_lock);
   auto tx_ptr = m_db_transactions.find(tx_id);
   CHECK_AND_ASSERT_MES(tx_ptr, false, "Can't find transaction id: " << tx_id);
-  transaction_chain_entry tce_local = *tx_ptr;
+  CHECK_AND_ASSERT_MES(n < tx_ptr->tx.vout.size(), false, "Wrong input offset: " << n << " in transaction id: " << tx_id);
 
-  CHECK_AND_ASSERT_MES(n < tce_local.m_spent_flags.size(), false, "Wrong input offset: " << n << " in transaction id: " << tx_id);
+  tx_spent_flags sf_local = AUTO_VAL_INIT(sf_local);
+  auto sf_ptr = m_db_spent_flags.find(tx_id);
+  if (sf_ptr)
+    sf_local = *sf_ptr;
+  sf_local.set(n, spent);
 
-  tce_local.m_spent_flags[n] = spent;
-  m_db_transactions.set(tx_id, tce_local);
+  if (sf_local.empty())
+    m_db_spent_flags.erase(tx_id);
+  else
+    m_db_spent_flags.set(tx_id, sf_local);
 
   return true;
 }
 //------------------------------------------------------------------
+bool blockchain_storage::is_tx_output_spent(const crypto::hash& tx_id, uint64_t n) const
+{
+  CRITICAL_REGION_LOCAL(m_read_lock);
+  auto sf_ptr = m_db_spent_flags.find(tx_id);
+  return sf_ptr && sf_ptr->is_spent(n);
+}
+//------------------------------------------------------------------
 bool blockchain_storage::update_spent_tx_flags_for_input(const crypto::hash& multisig_id, uint64_t spent_height)
 {
   CRITICAL_REGION_LOCAL(m_read_lock);
@@ -2632,9 +2793,9 @@ bool blockchain_storage::is_multisig_output_spent(const crypto::hash& multisig_i
 
   auto source_tx_ptr = m_db_transactions.find(source_tx_id);
   CHECK_AND_ASSERT_MES(source_tx_ptr, true, "Internal error: source tx not found for ms out " << multisig_id << ", ms out is treated as spent for safety");
-  CHECK_AND_ASSERT_MES(ms_out_index < source_tx_ptr->m_spent_flags.size(), true, "Internal error: ms out " << multisig_id << " has incorrect index " << ms_out_index << " in source tx " << source_tx_id << ", ms out is treated as spent for safety");
+  CHECK_AND_ASSERT_MES(ms_out_index < source_tx_ptr->tx.vout.size(), true, "Internal error: ms out " << multisig_id << " has incorrect index " << ms_out_index << " in source tx " << source_tx_id << ", ms out is treated as spent for safety");
 
-  return source_tx_ptr->m_spent_flags[ms_out_index];
+  return is_tx_output_spent(source_tx_id, ms_out_index);
 }
 //------------------------------------------------------------------
 bool blockchain_storage::find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, uint64_t& starter_offset)const
@@ -2829,8 +2990,8 @@ void blockchain_storage::print_blockchain_with_tx(uint64_t start_index, uint64_t
 
     for (size_t j = 0; j != m_db_blocks[i]->bl.tx_hashes.size(); j++)
     {
-      auto tx_it = m_db_transactions.find(m_db_blocks[i]->bl.tx_hashes[j]);
-      if (tx_it == m_db_transactions.end())
+      auto tx_it = get_full_tx_chain_entry(m_db_blocks[i]->bl.tx_hashes[j]);
+      if (!tx_it)
       {
         LOG_ERROR("internal error: tx id " << m_db_blocks[i]->bl.tx_hashes[j] << " not found in transactions index");
         continue;   
@@ -2871,6 +3032,7 @@ void blockchain_storage::print_db_cache_perfeormance_data() const
     DB_CONTAINER_PERF_DATA_ENTRY(m_db_blocks) << ENDL
     DB_CONTAINER_PERF_DATA_ENTRY(m_db_blocks_index) << ENDL
     DB_CONTAINER_PERF_DATA_ENTRY(m_db_transactions) << ENDL
+    DB_CONTAINER_PERF_DATA_ENTRY(m_db_spent_flags) << ENDL
     DB_CONTAINER_PERF_DATA_ENTRY(m_db_spent_keys) << ENDL
     //DB_CONTAINER_PERF_DATA_ENTRY(m_db_outputs) << ENDL
     DB_CONTAINER_PERF_DATA_ENTRY(m_db_multisig_outs) << ENDL
@@ -2953,25 +3115,17 @@ void blockchain_storage::print_blockchain_outs_stats() const
       LOG_ERROR("tx " << output_entry.tx_id << " not found");
       return true; // continue
     }
-    if (output_entry.out_no >= p_tx->m_spent_flags.size())
+    if (output_entry.out_no >= p_tx->tx.vout.size())
     {
       LOG_ERROR("tx with id " << output_entry.tx_id << " has wrong entry in global index, out_no = " << output_entry.out_no
-        << ", p_tx->m_spent_flags.size() = " << p_tx->m_spent_flags.size()
-        << ", p_tx->tx.vin.size() = " << p_tx->tx.vin.size());
-      return true; // continue
-    }
-    if (p_tx->tx.vout.size() != p_tx->m_spent_flags.size())
-    {
-      LOG_ERROR("Tx with id " << output_entry.tx_id << " has wrong entry in global index, out_no = " << output_entry.out_no
-        << ", p_tx->tx.vout.size() = " << p_tx->tx.vout.size()
-        << ", p_tx->m_spent_flags.size() = " << p_tx->m_spent_flags.size());
+        << ", p_tx->tx.vout.size() = " << p_tx->tx.vout.size());
       return true; // continue
     }
 
     auto& stat = outputs_stats[amount];
     ++stat.total;
       
-    bool spent = p_tx->m_spent_flags[output_entry.out_no];
+    bool spent = is_tx_output_spent(output_entry.tx_id, output_entry.out_no);
     if (!spent)
       ++stat.unspent;
       
@@ -3215,7 +3369,7 @@ bool blockchain_storage::find_blockchain_supplement(const std::list<crypto::hash
     get_transactions_direct(m_db_blocks[i]->bl.tx_hashes, blocks.back().second, mis);
     CHECK_AND_ASSERT_MES(!mis.size(), false, "internal error, block " << get_block_hash(m_db_blocks[i]->bl) << " [" << i << "] contains missing transactions: " << mis);
     if(request_coinbase_info)
-      blocks.back().third = m_db_transactions.find(get_transaction_hash(m_db_blocks[i]->bl.miner_tx));
+      blocks.back().third = get_full_tx_chain_entry(get_transaction_hash(m_db_blocks[i]->bl.miner_tx));
   }
   return true;
 }
@@ -3842,6 +3996,7 @@ namespace currency
 
 bool blockchain_storage::add_transaction_from_block(const transaction& tx, const crypto::hash& tx_id, const crypto::hash& bl_id, uint64_t bl_height, uint64_t timestamp)
 {
+  TRACE_SPAN("bcs::add_transaction_from_block");
   bool need_to_profile = !is_coinbase(tx);
   TIME_MEASURE_START_PD(tx_append_rl_wait);
   CRITICAL_REGION_LOCAL(m_read_lock);
@@ -3904,15 +4059,13 @@ bool blockchain_storage::add_transaction_from_block(const transaction& tx, const
   TIME_MEASURE_START_PD(tx_push_global_index);
   transaction_chain_entry ch_e;
   ch_e.m_keeper_block_height = bl_height;
-  ch_e.m_spent_flags.resize(tx.vout.size(), false);
-  ch_e.tx = tx;
   r = push_transaction_to_global_outs_index(tx, tx_id, ch_e.m_global_output_indexes);
   CHECK_AND_ASSERT_MES(r, false, "failed to return push_transaction_to_global_outs_index tx id " << tx_id);
   TIME_MEASURE_FINISH_PD_COND(need_to_profile, tx_push_global_index);
   
   //store everything to db
   TIME_MEASURE_START_PD(tx_store_db);
-  m_db_transactions.set(tx_id, ch_e);
+  store_tx_chain_entry(tx_id, ch_e, tx);
   TIME_MEASURE_FINISH_PD_COND(need_to_profile, tx_store_db);
 
   TIME_MEASURE_START_PD(tx_print_log);
@@ -3950,6 +4103,7 @@ bool blockchain_storage::get_tx_outputs_gindexs(const crypto::hash& tx_id, std::
 //------------------------------------------------------------------
 bool blockchain_storage::check_tx_inputs(const transaction& tx, const crypto::hash& tx_prefix_hash, uint64_t& max_used_block_height, crypto::hash& max_used_block_id) const
 {
+  TRACE_SPAN("bcs::check_tx_inputs");
   CRITICAL_REGION_LOCAL(m_read_lock);
   bool res = check_tx_inputs(tx, tx_prefix_hash, max_used_block_height);
   if(!res) return false;
@@ -4576,8 +4730,7 @@ bool blockchain_storage::check_tx_input(const transaction& tx, size_t in_index,
   LOC_CHK(source_tx_ptr, "Can't find source transaction");
   LOC_CHK(source_tx_ptr->tx.vout.size() > n, "ms output index is incorrect, source tx's vout size is " << source_tx_ptr->tx.vout.size());
   LOC_CHK(source_tx_ptr->tx.vout[n].target.type() == typeid(txout_multisig), "ms output has wrong type, txout_multisig expected");
-  LOC_CHK(source_tx_ptr->m_spent_flags.size() > n, "Internal error, m_spent_flags size (" << source_tx_ptr->m_spent_flags.size() << ") less then expected, n: " << n);
-  LOC_CHK(source_tx_ptr->m_spent_flags[n] == false, "Internal error, ms output is already spent"); // should never happen as multisig_ptr->spent_height is checked above
+  LOC_CHK(!is_tx_output_spent(source_tx_id, n), "Internal error, ms output is already spent"); // should never happen as multisig_ptr->spent_height is checked above
 
   if (!check_ms_input(tx, in_index, txin, tx_prefix_hash, sig, source_tx_ptr->tx, n))
     return false;
@@ -5239,7 +5392,9 @@ bool get_tx_from_cache(const crypto::hash& tx_id, transactions_map& tx_cache, tr
   if (it == tx_cache.end())
     return false;
 
-  tx = it->second;
+  // the cache entry is consumed by the block being handled, so take it without deep copy
+  tx = std::move(it->second);
+  tx_cache.erase(it);
   blob_size = get_object_blobsize(tx);
   fee = get_tx_fee(tx);
   return true;
@@ -5247,6 +5402,7 @@ bool get_tx_from_cache(const crypto::hash& tx_id, transactions_map& tx_cache, tr
 //------------------------------------------------------------------
 bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypto::hash& id, block_verification_context& bvc)
 {
+  TRACE_SPAN("bcs::handle_block_to_main_chain");
   TIME_MEASURE_START_PD_MS(block_processing_time_0_ms);
   CRITICAL_REGION_LOCAL(m_read_lock);
   TIME_MEASURE_START_PD(block_processing_time_1);
@@ -5782,6 +5938,7 @@ bool blockchain_storage::prevalidate_block(const block& bl)
 //------------------------------------------------------------------
 bool blockchain_storage::add_new_block(const block& bl, block_verification_context& bvc)
 {
+  TRACE_SPAN("bcs::add_new_block");
   try
   {
     m_db.begin_transaction();
@@ -5923,7 +6080,7 @@ bool blockchain_storage::calc_tx_cummulative_blob(const block& bl)const
     }
     else
     {
-      auto tx_ptr = m_db_transactions.get(h);
+      auto tx_ptr = get_full_tx_chain_entry(h);
       CHECK_AND_ASSERT_MES(tx_ptr, false, "tx " << h << " not found in blockchain nor tx_pool");
       calculated_sz = get_object_blobsize(tx_ptr->tx);
       blobdata b = t_serializable_object_to_blob(tx_ptr->tx);
@@ -6054,7 +6211,54 @@ const core_runtime_config& blockchain_storage::get_core_runtime_config() const
 std::shared_ptr<const transaction_chain_entry> blockchain_storage::get_tx_chain_entry(const crypto::hash& tx_hash) const
 {
   CRITICAL_REGION_LOCAL(m_read_lock);
-  return m_db_transactions.find(tx_hash);
+  return get_full_tx_chain_entry(tx_hash);
+}
+//------------------------------------------------------------------
+std::shared_ptr<const transaction_chain_entry> blockchain_storage::get_full_tx_chain_entry(const crypto::hash& tx_id) const
+{
+  CRITICAL_REGION_LOCAL(m_read_lock);
+  auto tx_ptr = m_db_transactions.find(tx_id);
+  if (!tx_ptr)
+    return tx_ptr;
+
+  auto sig_ptr = m_db_tx_signatures.find(tx_id);
+  auto att_ptr = m_db_tx_attachments.find(tx_id);
+  if (!sig_ptr && !att_ptr)
+    return tx_ptr; // pruned, has nothing to prune or was stored in one piece by older version
+
+  std::shared_ptr<transaction_chain_entry> res(new transaction_chain_entry(*tx_ptr));
+  if (sig_ptr)
+    res->tx.signatures = sig_ptr->signatures;
+  if (att_ptr)
+    res->tx.attachment = att_ptr->attachment;
+  return res;
+}
+//------------------------------------------------------------------
+void blockchain_storage::store_tx_chain_entry(const crypto::hash& tx_id, transaction_chain_entry& ch_e, const transaction& tx)
+{
+  static_cast<transaction_prefix&>(ch_e.tx) = tx;
+  ch_e.tx.signatures.clear();
+  ch_e.tx.attachment.clear();
+  m_db_transactions.set(tx_id, ch_e);
+
+  if (tx.signatures.size())
+  {
+    tx_signatures_entry se = AUTO_VAL_INIT(se);
+    se.signatures = tx.signatures;
+    m_db_tx_signatures.set(tx_id, se);
+  }
+  if (tx.attachment.size())
+  {
+    tx_attachments_entry ae = AUTO_VAL_INIT(ae);
+    ae.attachment = tx.attachment;
+    m_db_tx_attachments.set(tx_id, ae);
+  }
+}
+//------------------------------------------------------------------
+void blockchain_storage::erase_tx_prunable_data(const crypto::hash& tx_id)
+{
+  m_db_tx_signatures.erase_validate(tx_id);
+  m_db_tx_attachments.erase_validate(tx_id);
 }
 //------------------------------------------------------------------
 bool blockchain_storage::get_tx_chain_entry(const crypto::hash& tx_hash, transaction_chain_entry& entry) const
@@ -6063,6 +6267,9 @@ bool blockchain_storage::get_tx_chain_entry(const crypto::hash& tx_hash, transac
   if (!ch_entry_ptr)
     return false;
   entry = *ch_entry_ptr;
+  entry.m_spent_flags.resize(entry.tx.vout.size());
+  for (size_t i = 0; i != entry.m_spent_flags.size(); i++)
+    entry.m_spent_flags[i] = is_tx_output_spent(tx_hash, i);
   return true;
 }
 //------------------------------------------------------------------
@@ -6692,7 +6899,7 @@ bool blockchain_storage::get_transaction_from_pool_or_db(const crypto::hash& tx_
 
   if (!m_tx_pool.get_transaction(tx_id, *tx_ptr)) // first try to get from the pool
   {
-    auto p = m_db_transactions.get(tx_id); // if not found in the pool -- get from the DB
+    auto p = get_full_tx_chain_entry(tx_id); // if not found in the pool -- get from the DB
     if (p == nullptr)
     {
       return false;
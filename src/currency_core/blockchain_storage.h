@@ -13,6 +13,9 @@
 
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/version.hpp>
+#if BOOST_VERSION / 100000 == 1 && BOOST_VERSION / 100 % 1000 == 74
+#include <boost/serialization/library_version_type.hpp>
+#endif
 #include <boost/serialization/list.hpp>
 
 #include <boost/foreach.hpp>
@@ -60,46 +63,46 @@ namespace currency
     struct performnce_data
     {
       //block processing zone
-      epee::math_helper::average<uint64_t, 5> block_processing_time_0_ms;
-      epee::math_helper::average<uint64_t, 5> block_processing_time_1;
-      epee::math_helper::average<uint64_t, 5> target_calculating_time_2;
-      epee::math_helper::average<uint64_t, 5> longhash_calculating_time_3;
-      epee::math_helper::average<uint64_t, 5> all_txs_insert_time_5;
-      epee::math_helper::average<uint64_t, 5> etc_stuff_6;
-      epee::math_helper::average<uint64_t, 5> insert_time_4;
-      epee::math_helper::average<uint64_t, 5> raise_block_core_event;
+      epee::math_helper::average_with_histogram<uint64_t, 5> block_processing_time_0_ms;
+      epee::math_helper::average_with_histogram<uint64_t, 5> block_processing_time_1;
+      epee::math_helper::average_with_histogram<uint64_t, 5> target_calculating_time_2;
+      epee::math_helper::average_with_histogram<uint64_t, 5> longhash_calculating_time_3;
+      epee::math_helper::average_with_histogram<uint64_t, 5> all_txs_insert_time_5;
+      epee::math_helper::average_with_histogram<uint64_t, 5> etc_stuff_6;
+      epee::math_helper::average_with_histogram<uint64_t, 5> insert_time_4;
+      epee::math_helper::average_with_histogram<uint64_t, 5> raise_block_core_event;
       //target_calculating_time_2
-      epee::math_helper::average<uint64_t, 5> target_calculating_enum_blocks;
-      epee::math_helper::average<uint64_t, 5> target_calculating_calc;
+      epee::math_helper::average_with_histogram<uint64_t, 5> target_calculating_enum_blocks;
+      epee::math_helper::average_with_histogram<uint64_t, 5> target_calculating_calc;
 
       //tx processing zone
-      epee::math_helper::average<uint64_t, 1> tx_check_inputs_time;
-      epee::math_helper::average<uint64_t, 1> tx_add_one_tx_time;
-      epee::math_helper::average<uint64_t, 1> tx_process_extra;
-      epee::math_helper::average<uint64_t, 1> tx_process_attachment;
-      epee::math_helper::average<uint64_t, 1> tx_process_inputs ;
-      epee::math_helper::average<uint64_t, 1> tx_push_global_index;
-      epee::math_helper::average<uint64_t, 1> tx_check_exist;
-      epee::math_helper::average<uint64_t, 1> tx_print_log;
-      epee::math_helper::average<uint64_t, 1> tx_prapare_append;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_check_inputs_time;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_add_one_tx_time;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_process_extra;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_process_attachment;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_process_inputs ;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_push_global_index;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_check_exist;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_print_log;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_prapare_append;
               
-      epee::math_helper::average<uint64_t, 1> tx_append_time;
-      epee::math_helper::average<uint64_t, 1> tx_append_rl_wait;
-      epee::math_helper::average<uint64_t, 1> tx_append_is_expired;
-
-      epee::math_helper::average<uint64_t, 1> tx_store_db;
-
-      epee::math_helper::average<uint64_t, 1> tx_check_inputs_prefix_hash;
-      epee::math_helper::average<uint64_t, 1> tx_check_inputs_attachment_check;
-      epee::math_helper::average<uint64_t, 1> tx_check_inputs_loop;
-      epee::math_helper::average<uint64_t, 1> tx_check_inputs_loop_kimage_check;
-      epee::math_helper::average<uint64_t, 1> tx_check_inputs_loop_ch_in_val_sig;
-      epee::math_helper::average<uint64_t, 1> tx_check_inputs_loop_scan_outputkeys_get_item_size;
-      epee::math_helper::average<uint64_t, 1> tx_check_inputs_loop_scan_outputkeys_relative_to_absolute;
-      epee::math_helper::average<uint64_t, 1> tx_check_inputs_loop_scan_outputkeys_loop;
-      epee::math_helper::average<uint64_t, 1> tx_check_inputs_loop_scan_outputkeys_loop_get_subitem;
-      epee::math_helper::average<uint64_t, 1> tx_check_inputs_loop_scan_outputkeys_loop_find_tx;
-      epee::math_helper::average<uint64_t, 1> tx_check_inputs_loop_scan_outputkeys_loop_handle_output;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_append_time;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_append_rl_wait;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_append_is_expired;
+
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_store_db;
+
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_check_inputs_prefix_hash;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_check_inputs_attachment_check;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_check_inputs_loop;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_check_inputs_loop_kimage_check;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_check_inputs_loop_ch_in_val_sig;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_check_inputs_loop_scan_outputkeys_get_item_size;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_check_inputs_loop_scan_outputkeys_relative_to_absolute;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_check_inputs_loop_scan_outputkeys_loop;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_check_inputs_loop_scan_outputkeys_loop_get_subitem;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_check_inputs_loop_scan_outputkeys_loop_find_tx;
+      epee::math_helper::average_with_histogram<uint64_t, 1> tx_check_inputs_loop_scan_outputkeys_loop_handle_output;
 
       epee::math_helper::average<uint64_t, 1> tx_mixin_count;
 
@@ -141,6 +144,27 @@ namespace currency
       std::list<txout_htlc> htlc_outs;
     };
 
+    // Pins main chain db state for the calling thread: everything read from the db while it's alive (blocks, txs,
+    // outputs, key images) belongs to the same committed state, and the thread doesn't wait for block commits.
+    // Create it before any other lock or db transaction of the thread and don't write to the db while it's alive.
+    // In-memory alt chains and tx pool are not covered.
+    class read_snapshot
+    {
+    public:
+      read_snapshot(const blockchain_storage& bcs) : m_db(bcs.m_db)
+      {
+        m_db.begin_read_snapshot();
+      }
+      ~read_snapshot()
+      {
+        NESTED_TRY_ENTRY();
+        m_db.end_read_snapshot();
+        NESTED_CATCH_ENTRY(__func__);
+      }
+    private:
+      const tools::db::basic_db_accessor& m_db;
+    };
+
     // == Output indexes local lookup table conception ==
     // Main chain gindex table (outputs_container) contains data which is valid only for the most recent block.
     // Thus it can't be used to get output's global index for any arbitrary height because there's no height data.
@@ -196,6 +220,11 @@ namespace currency
     //TODO: set this method to const
     checkpoints& get_checkpoints() { return m_checkpoints; }
     bool is_in_checkpoint_zone() const { return m_is_in_checkpoint_zone; }
+    // prunes signatures and attachments of txs below the last passed checkpoint, one small DB transaction per call
+    // (limited by --db-pruning-batch-txs / --db-pruning-batch-ms), supposed to be called periodically from core's idle loop
+    bool prune_ring_signatures_and_attachments_if_need();
+    uint64_t get_pruned_rs_height() const;
+    uint64_t get_pruning_target_height() const;
    
     //------------- modifying members --------------
     bool add_new_block(const block& bl_, block_verification_context& bvc);
@@ -312,6 +341,7 @@ namespace currency
     uint64_t get_seconds_between_last_n_block(size_t n)const;
     bool has_multisig_output(const crypto::hash& multisig_id) const;
     bool is_multisig_output_spent(const crypto::hash& multisig_id) const;
+    bool is_tx_output_spent(const crypto::hash& tx_id, uint64_t n) const;
     boost::multiprecision::uint128_t total_coins()const;
     bool is_pos_allowed()const;
     uint64_t get_tx_fee_median()const;
@@ -324,6 +354,7 @@ namespace currency
     bool prevalidate_alias_info(const transaction& tx, const extra_alias_entry& eae);
     bool validate_miner_transaction(const block& b, size_t cumulative_block_size, uint64_t fee, uint64_t& base_reward, const boost::multiprecision::uint128_t& already_generated_coins) const;
     performnce_data& get_performnce_data()const;
+    const tools::db::basic_db_accessor::performance_data& get_db_performance_data() const { return m_db.get_performance_data_global(); }
     bool validate_instance(const std::string& path);
     bool is_tx_expired(const transaction& tx) const;
     std::shared_ptr<const transaction_chain_entry> find_key_image_and_related_tx(const crypto::key_image& ki, crypto::hash& id_result) const;
@@ -410,7 +441,7 @@ namespace currency
 
       BOOST_FOREACH(const auto& tx_id, txs_ids)
       {
-        auto tx_ptr = m_db_transactions.find(tx_id);
+        auto tx_ptr = get_full_tx_chain_entry(tx_id);
         if (!tx_ptr)
         {
           transaction tx;
@@ -433,7 +464,7 @@ namespace currency
 
       for(const auto& tx_id: txs_ids)
       {
-        auto tx_ptr = m_db_transactions.find(tx_id);
+        auto tx_ptr = get_full_tx_chain_entry(tx_id);
         if (!tx_ptr)
           missed_txs.push_back(tx_id);
         else
@@ -478,6 +509,9 @@ namespace currency
     //-------------- DB containers --------------
     typedef tools::db::cached_key_value_accessor<crypto::hash, uint64_t, false, false> blocks_by_id_index;
     typedef tools::db::cached_key_value_accessor<crypto::hash, transaction_chain_entry, true, false> transactions_container; 
+    typedef tools::db::cached_key_value_accessor<crypto::hash, tx_spent_flags, true, false> spent_flags_container; // tx id => spent outputs bitmap, no entry means nothing spent
+    typedef tools::db::basic_key_value_accessor<crypto::hash, tx_signatures_entry, true> tx_signatures_container; // tx id => ring signatures, erased by pruning
+    typedef tools::db::basic_key_value_accessor<crypto::hash, tx_attachments_entry, true> tx_attachments_container; // tx id => attachments, erased by pruning
     
     typedef tools::db::array_accessor<block_extended_info, true> blocks_container;      
 
@@ -502,10 +536,12 @@ namespace currency
     which can lead to wrong interpretation of core data structure (state of the core changed while reader assume that state is the same).
     To avoid this cases we use read-write lock, which acquired exclusive access only when writer finished his work and want to commit changes
     and enable caches - with this acquiring writer wait wile all readers finish their reading.
+    Readers inside read_snapshot don't take it: db transaction keeps their view unchanged, and caches are served
+    to them only while no commit happened since the snapshot was taken.
     */
     epee::shared_recursive_mutex m_rw_lock;
     //mutable dummy_critical_section m_read_lock; 
-    mutable epee::shared_membership<epee::shared_recursive_mutex> m_read_lock;
+    mutable tools::db::snapshot_aware_shared_membership m_read_lock;
 
     //---------- db members ---------------------
     //main accessor
@@ -514,6 +550,9 @@ namespace currency
     blocks_container m_db_blocks;
     blocks_by_id_index m_db_blocks_index;
     transactions_container m_db_transactions;
+    spent_flags_container m_db_spent_flags;
+    tx_signatures_container m_db_tx_signatures;
+    tx_attachments_container m_db_tx_attachments;
     key_images_container m_db_spent_keys;
     solo_options_container m_db_solo_options;
     tools::db::solo_db_value<uint64_t, uint64_t, solo_options_container> m_db_current_block_cumul_sz_limit;
@@ -540,6 +579,9 @@ namespace currency
 
     std::atomic<bool> m_is_in_checkpoint_zone;
     std::atomic<bool> m_is_blockchain_storing;
+    uint64_t m_pruning_batch_txs;
+    uint64_t m_pruning_batch_ms;
+    uint64_t m_pruning_session_txs;          // txs pruned since current pruning run started (informational)
 
     std::string m_config_folder;
     //events
@@ -642,8 +684,7 @@ namespace currency
     bool put_alias_info(const transaction& tx, extra_alias_entry& ai);
     void fill_addr_to_alias_dict();
     //bool resync_spent_tx_flags();
-    bool prune_ring_signatures_and_attachments_if_need();
-    bool prune_ring_signatures_and_attachments(uint64_t height, uint64_t& transactions_pruned, uint64_t& signatures_pruned, uint64_t& attachments_pruned);
+    bool prune_ring_signatures_and_attachments(uint64_t height, uint64_t& transactions_pruned);
     //    bool build_stake_modifier_for_alt(const alt_chain_type& alt_chain, stake_modifier_type& sm);
     template<class visitor_t>
     bool enum_blockchain(visitor_t& v, const alt_chain_type& alt_chain = alt_chain_type(), uint64_t split_height = 0) const;
@@ -651,6 +692,10 @@ namespace currency
     bool update_spent_tx_flags_for_input(uint64_t amount, uint64_t global_index, bool spent);
     bool update_spent_tx_flags_for_input(const crypto::hash& multisig_id, uint64_t spent_height);
     bool update_spent_tx_flags_for_input(const crypto::hash& tx_id, size_t n, bool spent);
+    bool migrate_spent_flags_to_separate_container();
+    std::shared_ptr<const transaction_chain_entry> get_full_tx_chain_entry(const crypto::hash& tx_id) const;
+    void store_tx_chain_entry(const crypto::hash& tx_id, transaction_chain_entry& ch_e, const transaction& tx);
+    void erase_tx_prunable_data(const crypto::hash& tx_id);
     
     void push_block_to_per_block_increments(uint64_t height_, std::unordered_map<uint64_t, uint32_t>& gindices);
     void pop_block_from_per_block_increments(uint64_t height_);
@@ -789,9 +834,7 @@ namespace currency
       else if (tx_ptr->tx.vout[n].target.type() == typeid(txout_htlc))
       {
         //check for spend flags
-        CHECK_AND_ASSERT_MES(tx_ptr->m_spent_flags.size() > n, false, 
-          "Internal error: tx_ptr->m_spent_flags.size(){" << tx_ptr->m_spent_flags.size() << "} > n{" << n << "}");
-        CHECK_AND_ASSERT_MES(tx_ptr->m_spent_flags[n] == false, false, "HTLC out already spent, double spent attempt detected");
+        CHECK_AND_ASSERT_MES(!is_tx_output_spent(tx_id, n), false, "HTLC out already spent, double spent attempt detected");
 
         const txout_htlc& htlc_out = boost::get<txout_htlc>(tx_ptr->tx.vout[n].target);
         if (htlc_out.expiration > get_current_blockchain_size() - tx_ptr->m_keeper_block_height)
@@ -44,6 +44,63 @@ namespace currency
     END_SERIALIZE()
   };
 
+  // Spent state of transaction outputs, kept apart from transaction_chain_entry (whose m_spent_flags is not maintained anymore)
+  // so spending an output rewrites a few bytes instead of the whole transaction. Bit n % 64 of word n / 64 is set when output n is spent.
+  struct tx_spent_flags
+  {
+    std::vector<uint64_t> bits;
+
+    bool empty() const { return bits.empty(); }
+
+    bool is_spent(uint64_t n) const
+    {
+      uint64_t w = n / 64;
+      return w < bits.size() && (bits[w] & (1ULL << (n % 64))) != 0;
+    }
+
+    void set(uint64_t n, bool spent)
+    {
+      uint64_t w = n / 64;
+      if (spent)
+      {
+        if (w >= bits.size())
+          bits.resize(w + 1, 0);
+        bits[w] |= 1ULL << (n % 64);
+      }
+      else if (w < bits.size())
+      {
+        bits[w] &= ~(1ULL << (n % 64));
+        while (!bits.empty() && bits.back() == 0)
+          bits.pop_back();
+      }
+    }
+
+    BEGIN_SERIALIZE_OBJECT()
+      FIELD(bits)
+    END_SERIALIZE()
+  };
+
+  // Prunable parts of a transaction. They are stored in their own containers, while transaction_chain_entry keeps
+  // only prefix (inputs, outputs, extra) and chain metadata, so lookups on validation paths don't deserialize them
+  // and pruning is a plain erase. Entries written by older versions may still keep everything in transaction_chain_entry.
+  struct tx_signatures_entry
+  {
+    std::vector<std::vector<crypto::signature> > signatures;
+
+    BEGIN_SERIALIZE_OBJECT()
+      FIELD(signatures)
+    END_SERIALIZE()
+  };
+
+  struct tx_attachments_entry
+  {
+    std::vector<attachment_v> attachment;
+
+    BEGIN_SERIALIZE_OBJECT()
+      FIELD(attachment)
+    END_SERIALIZE()
+  };
+
   struct block_extended_info
   {
     block   bl;
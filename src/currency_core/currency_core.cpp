@@ -642,6 +642,7 @@ namespace currency
     }
 
     m_prune_alt_blocks_interval.do_call([this](){return m_blockchain_storage.prune_aged_alt_blocks();});
+    m_blockchain_storage.prune_ring_signatures_and_attachments_if_need(); // does a small batch per call, if there's something to prune
     m_check_free_space_interval.do_call([this](){ check_free_space(); return true; });
     m_miner.on_idle();
     m_mempool.on_idle();
@@ -2620,7 +2620,7 @@ namespace currency
     {
       tei.outs.push_back(tx_out_rpc_entry());
       tei.outs.back().amount = out.amount;
-      tei.outs.back().is_spent = ptce ? ptce->m_spent_flags[i] : false;
+      tei.outs.back().is_spent = ptce && i < ptce->m_spent_flags.size() ? ptce->m_spent_flags[i] : false; // blockchain_storage overrides it with actual state
       tei.outs.back().global_index = ptce ? ptce->m_global_output_indexes[i] : 0;
 
       if (out.target.type() == typeid(txout_to_key))
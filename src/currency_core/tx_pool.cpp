@@ -31,7 +31,7 @@ DISABLE_VS_WARNINGS(4244 4345 4503) //'boost::foreach_detail_::or_' : decorated
 #define TRANSACTION_POOL_CONTAINER_KEY_IMAGES             "key_images"
 #define TRANSACTION_POOL_CONTAINER_SOLO_OPTIONS           "solo"
 #define TRANSACTION_POOL_OPTIONS_ID_STORAGE_MAJOR_COMPATIBILITY_VERSION 92 // DON'T CHANGE THIS, if you need to resync db! Change TRANSACTION_POOL_MAJOR_COMPATIBILITY_VERSION instead!
-#define TRANSACTION_POOL_MAJOR_COMPATIBILITY_VERSION      BLOCKCHAIN_STORAGE_MAJOR_COMPATIBILITY_VERSION + 1
+#define TRANSACTION_POOL_MAJOR_COMPATIBILITY_VERSION      BLOCKCHAIN_STORAGE_MAJOR_COMPATIBILITY_VERSION + 2
 
 
 #define CONFLICT_KEY_IMAGE_SPENT_DEPTH_TO_REMOVE_TX_FROM_POOL 50 // if there's a conflict in key images between tx in the pool and in the blockchain this much depth in required to remove correspongin tx from pool
@@ -50,7 +50,7 @@ namespace currency
     m_db_transactions(m_db),
     m_db_black_tx_list(m_db),
     m_db_solo_options(m_db), 
-//    m_db_key_images_set(m_db),
+    m_db_key_images(m_db),
     m_db_alias_names(m_db),
     m_db_alias_addresses(m_db),
     m_db_storage_major_compatibility_version(TRANSACTION_POOL_OPTIONS_ID_STORAGE_MAJOR_COMPATIBILITY_VERSION, m_db_solo_options)
@@ -92,6 +92,7 @@ namespace currency
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::add_tx(const transaction &tx, const crypto::hash &id, uint64_t blob_size, tx_verification_context& tvc, bool kept_by_block, bool from_core)
   {    
+    TRACE_SPAN("pool::add_tx");
     if (!kept_by_block && !from_core && m_blockchain.is_in_checkpoint_zone())
     {
       // BCS is in CP zone, tx verification is impossible until it gets synchronized
@@ -724,15 +725,19 @@ namespace currency
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::insert_key_images(const crypto::hash &tx_id, const transaction& tx, bool kept_by_block)
   {
-    CRITICAL_REGION_LOCAL(m_key_images_lock);
     for(const auto& in : tx.vin)
     {
       if (in.type() == typeid(txin_to_key))
       {
         const txin_to_key& tokey_in = boost::get<txin_to_key>(in);
-        auto& id_set = m_key_images[tokey_in.k_image];
+        std::vector<crypto::hash> id_set;
+        auto pid_set = m_db_key_images.get(tokey_in.k_image);
+        if (pid_set)
+          id_set = *pid_set;
         size_t sz_before = id_set.size();
-        id_set.insert(tx_id);
+        if (std::find(id_set.begin(), id_set.end(), tx_id) == id_set.end())
+          id_set.push_back(tx_id);
+        m_db_key_images.set(tokey_in.k_image, id_set);
         LOG_PRINT_L2("tx pool: key image added: " << tokey_in.k_image << ", from tx " << tx_id << ", counter: " << sz_before << " -> " << id_set.size());
       }
     }
@@ -784,23 +789,27 @@ namespace currency
   //--------------------------------------------------------------------------------- 
   bool tx_memory_pool::remove_key_images(const crypto::hash &tx_id, const transaction& tx, bool kept_by_block)
   {
-    CRITICAL_REGION_LOCAL(m_key_images_lock);
     for(const auto& in : tx.vin)
     {
       if (in.type() == typeid(txin_to_key))
       {        
         const txin_to_key& tokey_in = boost::get<txin_to_key>(in);
 
-        auto it_map = epee::misc_utils::it_get_or_insert_value_initialized(m_key_images, tokey_in.k_image);
-        auto& id_set = it_map->second;
+        auto pid_set = m_db_key_images.get(tokey_in.k_image);
+        if (!pid_set)
+        {
+          LOG_PRINT_L2("tx pool: key image to remove not found: " << tokey_in.k_image << ", from tx " << tx_id);
+          continue;
+        }
+        std::vector<crypto::hash> id_set = *pid_set;
         size_t count_before = id_set.size();
-        auto it_set =  id_set.find(tx_id);
-        if(it_set != id_set.end())
-          id_set.erase(it_set);
+        id_set.erase(std::remove(id_set.begin(), id_set.end(), tx_id), id_set.end());
 
         size_t count_after = id_set.size();
         if (id_set.size() == 0)
-          m_key_images.erase(it_map);
+          m_db_key_images.erase(tokey_in.k_image);
+        else if (count_after != count_before)
+          m_db_key_images.set(tokey_in.k_image, id_set);
 
         LOG_PRINT_L2("tx pool: key image removed: " << tokey_in.k_image << ", from tx " << tx_id << ", counter: " << count_before << " -> " << count_after);
       }
@@ -808,29 +817,10 @@ namespace currency
     return false;
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::get_key_images_from_tx_pool(key_image_cache& key_images) const
-  {
-    
-    m_db_transactions.enumerate_items([&](uint64_t i, const crypto::hash& h, const tx_details &tx_entry)
-    {
-      for (auto& in : tx_entry.tx.vin)
-      {
-        if (in.type() == typeid(txin_to_key))
-        {
-          key_images[boost::get<txin_to_key>(in).k_image].insert(h);
-        }
-      }
-      return true;
-    });
-
-    return true;
-  }
-  //---------------------------------------------------------------------------------
   bool tx_memory_pool::have_tx_keyimg_as_spent(const crypto::key_image& key_im)const
   {
-    CRITICAL_REGION_LOCAL(m_key_images_lock);
-    auto it = m_key_images.find(key_im);
-    if (it != m_key_images.end())
+    // no pool-wide lock: committed pool db state is read, writers don't block it
+    if (m_db_key_images.get(key_im))
       return true;
     return false;
   }
@@ -850,9 +840,9 @@ namespace currency
     
     m_db.begin_transaction();
     m_db_transactions.clear();
+    m_db_key_images.clear();
     m_db.commit_transaction();
     // should m_db_black_tx_list be cleared here?
-    CIRITCAL_OPERATION(m_key_images,clear());
   }
   //---------------------------------------------------------------------------------
   void tx_memory_pool::clear()
@@ -860,8 +850,8 @@ namespace currency
     m_db.begin_transaction();
     m_db_transactions.clear();
     m_db_black_tx_list.clear();
+    m_db_key_images.clear();
     m_db.commit_transaction();
-    CIRITCAL_OPERATION(m_key_images,clear());
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::is_transaction_ready_to_go(tx_details& txd, const crypto::hash& id)const 
@@ -1225,6 +1215,8 @@ namespace currency
       CHECK_AND_ASSERT_MES(res, false, "Unable to init db container");
       res = m_db_black_tx_list.init(TRANSACTION_POOL_CONTAINER_BLACK_TX_LIST);
       CHECK_AND_ASSERT_MES(res, false, "Unable to init db container");
+      res = m_db_key_images.init(TRANSACTION_POOL_CONTAINER_KEY_IMAGES);
+      CHECK_AND_ASSERT_MES(res, false, "Unable to init db container");
       res = m_db_alias_names.init(TRANSACTION_POOL_CONTAINER_ALIAS_NAMES);
       CHECK_AND_ASSERT_MES(res, false, "Unable to init db container");
       res = m_db_alias_addresses.init(TRANSACTION_POOL_CONTAINER_ALIAS_ADDRESSES);
@@ -1236,6 +1228,7 @@ namespace currency
       m_db_alias_names.set_cache_size(10000);
       m_db_alias_addresses.set_cache_size(10000);
       m_db_black_tx_list.set_cache_size(1000);
+      m_db_key_images.set_cache_size(10000);
 
       bool need_reinit = false;
       if (m_db_storage_major_compatibility_version > 0 && m_db_storage_major_compatibility_version != TRANSACTION_POOL_MAJOR_COMPATIBILITY_VERSION)
@@ -1248,7 +1241,7 @@ namespace currency
       {
         LOG_PRINT_L1("DB at " << db_folder_path << " is about to be deleted and re-created...");
         m_db_transactions.deinit();
-//        m_db_key_images_set.deinit();
+        m_db_key_images.deinit();
         m_db_black_tx_list.deinit();
         m_db_alias_names.deinit();
         m_db_alias_addresses.deinit();
@@ -1281,17 +1274,9 @@ namespace currency
       LOG_PRINT_L2(ss.str());
     }
 
-    load_keyimages_cache();
-
     return true;
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::load_keyimages_cache()
-  {
-    CRITICAL_REGION_LOCAL(m_key_images_lock);
-    return get_key_images_from_tx_pool(m_key_images);    
-  }
-  //---------------------------------------------------------------------------------
   bool tx_memory_pool::deinit()
   {
     m_db.close();
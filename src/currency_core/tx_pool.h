@@ -69,20 +69,18 @@ namespace currency
     struct performnce_data
     {
       //tx zone
-      epee::math_helper::average<uint64_t, 5> tx_processing_time;
-      epee::math_helper::average<uint64_t, 5> check_inputs_types_supported_time;
-      epee::math_helper::average<uint64_t, 5> expiration_validate_time;
-      epee::math_helper::average<uint64_t, 5> validate_amount_time;
-      epee::math_helper::average<uint64_t, 5> validate_alias_time;
-      epee::math_helper::average<uint64_t, 5> check_keyimages_ws_ms_time;
-      epee::math_helper::average<uint64_t, 5> check_inputs_time;
-      epee::math_helper::average<uint64_t, 5> begin_tx_time;
-      epee::math_helper::average<uint64_t, 5> update_db_time;
-      epee::math_helper::average<uint64_t, 5> db_commit_time;      
+      epee::math_helper::average_with_histogram<uint64_t, 5> tx_processing_time;
+      epee::math_helper::average_with_histogram<uint64_t, 5> check_inputs_types_supported_time;
+      epee::math_helper::average_with_histogram<uint64_t, 5> expiration_validate_time;
+      epee::math_helper::average_with_histogram<uint64_t, 5> validate_amount_time;
+      epee::math_helper::average_with_histogram<uint64_t, 5> validate_alias_time;
+      epee::math_helper::average_with_histogram<uint64_t, 5> check_keyimages_ws_ms_time;
+      epee::math_helper::average_with_histogram<uint64_t, 5> check_inputs_time;
+      epee::math_helper::average_with_histogram<uint64_t, 5> begin_tx_time;
+      epee::math_helper::average_with_histogram<uint64_t, 5> update_db_time;
+      epee::math_helper::average_with_histogram<uint64_t, 5> db_commit_time;      
     };
 
-    typedef std::unordered_map<crypto::key_image, std::set<crypto::hash>> key_image_cache;
-
     tx_memory_pool(blockchain_storage& bchs, i_currency_protocol* pprotocol);
     bool add_tx(const transaction &tx, const crypto::hash &id, uint64_t blob_size, tx_verification_context& tvc, bool kept_by_block, bool from_core = false);
     bool add_tx(const transaction &tx, tx_verification_context& tvc, bool kept_by_block, bool from_core = false);
@@ -151,14 +149,13 @@ namespace currency
     void store_db_solo_options_values();
     bool is_transaction_ready_to_go(tx_details& txd, const crypto::hash& id)const;
     bool validate_alias_info(const transaction& tx, bool is_in_block)const;
-    bool get_key_images_from_tx_pool(key_image_cache& key_images) const;
     bool check_is_taken(const crypto::hash& id) const;
     void set_taken(const crypto::hash& id);
     void reset_all_taken();
-    bool load_keyimages_cache();
     
     typedef tools::db::cached_key_value_accessor<crypto::hash, tx_details, true, false> transactions_container;
     typedef tools::db::cached_key_value_accessor<crypto::hash, bool, false, false> hash_container; 
+    typedef tools::db::cached_key_value_accessor<crypto::key_image, std::vector<crypto::hash>, true, false> key_images_container; // key image => ids of pool txs spending it
     typedef tools::db::cached_key_value_accessor<uint64_t, uint64_t, false, true> solo_options_container;
     typedef tools::db::cached_key_value_accessor<std::string, bool, false, false> aliases_container; 
     typedef tools::db::cached_key_value_accessor<account_public_address, bool, false, false> address_to_aliases_container;
@@ -171,6 +168,7 @@ namespace currency
 
     transactions_container m_db_transactions;
     hash_container  m_db_black_tx_list;
+    key_images_container m_db_key_images;
     aliases_container m_db_alias_names;
     address_to_aliases_container m_db_alias_addresses;
     solo_options_container m_db_solo_options;
@@ -188,8 +186,6 @@ namespace currency
     mutable epee::critical_section m_taken_txs_lock;
     std::unordered_set<crypto::hash> m_taken_txs;
 
-    mutable epee::critical_section m_key_images_lock;
-    key_image_cache m_key_images;
     mutable epee::critical_section m_remove_stuck_txs_lock;
 
   };
@@ -245,6 +245,7 @@ namespace currency
     template<class t_core> 
     int t_currency_protocol_handler<t_core>::handle_notify_new_block(int command, NOTIFY_NEW_BLOCK::request& arg, currency_connection_context& context)
   {
+    TRACE_SPAN("p2p::handle_notify_new_block");
     //do not process requests if it comes from node wich is debugged
     if (m_debug_ip_address != 0 && context.m_remote_ip == m_debug_ip_address)
         return 1;
@@ -327,7 +328,7 @@ namespace currency
         m_p2p->drop_connection(context);
         return 1;
       }
-      bvc.m_onboard_transactions[tx_hash] = tx;
+      bvc.m_onboard_transactions[tx_hash] = std::move(tx);
     }
     
     m_core.pause_mine();
@@ -384,6 +385,7 @@ namespace currency
   template<class t_core>
   int t_currency_protocol_handler<t_core>::handle_new_transaction_from_net(NOTIFY_OR_INVOKE_NEW_TRANSACTIONS::request& arg, NOTIFY_OR_INVOKE_NEW_TRANSACTIONS::response& rsp, currency_connection_context& context, bool is_notify)
   {
+    TRACE_SPAN("p2p::handle_new_transaction_from_net");
     //do not process requests if it comes from node wich is debugged
     if (m_debug_ip_address != 0 && context.m_remote_ip == m_debug_ip_address)
     {
@@ -446,6 +448,7 @@ namespace currency
   template<class t_core> 
   int t_currency_protocol_handler<t_core>::handle_request_get_objects(int command, NOTIFY_REQUEST_GET_OBJECTS::request& arg, currency_connection_context& context)
   {
+    TRACE_SPAN("p2p::handle_request_get_objects");
     //do not process requests if it comes from node wich is debugged
     if (m_debug_ip_address != 0 && context.m_remote_ip == m_debug_ip_address)
       return 1;
@@ -495,6 +498,7 @@ namespace currency
   template<class t_core>
   int t_currency_protocol_handler<t_core>::handle_response_get_objects(int command, NOTIFY_RESPONSE_GET_OBJECTS::request& arg, currency_connection_context& context)
   {
+    TRACE_SPAN("p2p::handle_response_get_objects");
     //do not process requests if it comes from node wich is debugged
     if (m_debug_ip_address != 0 && context.m_remote_ip == m_debug_ip_address)
       return 1;
@@ -585,6 +589,7 @@ namespace currency
         block_verification_context bvc = boost::value_initialized<block_verification_context>();
         //process transactions
         TIME_MEASURE_START(transactions_process_time);
+        bvc.m_onboard_transactions.reserve(block_entry.txs.size());
         for (const auto& tx_blob : block_entry.txs)
         {
           CHECK_STOP_FLAG__DROP_AND_RETURN_IF_SET(1, "Block txs processing interrupted, connection dropped");
@@ -597,7 +602,7 @@ namespace currency
             m_p2p->drop_connection(context);
             return 1;
           }
-          bvc.m_onboard_transactions[tx_id] = tx;
+          bvc.m_onboard_transactions[tx_id] = std::move(tx);
 //           tx_verification_context tvc = AUTO_VAL_INIT(tvc);
 //           m_core.handle_incoming_tx(tx_blob, tvc, true);
 //           if(tvc.m_verification_failed)
@@ -681,6 +686,7 @@ namespace currency
   template<class t_core>
   int t_currency_protocol_handler<t_core>::handle_request_chain(int command, NOTIFY_REQUEST_CHAIN::request& arg, currency_connection_context& context)
   {
+    TRACE_SPAN("p2p::handle_request_chain");
     //do not process requests if it comes from node wich is debugged
     if (m_debug_ip_address != 0 && context.m_remote_ip == m_debug_ip_address)
       return 1;
@@ -925,6 +931,7 @@ namespace currency
   template<class t_core> 
   int t_currency_protocol_handler<t_core>::handle_response_chain_entry(int command, NOTIFY_RESPONSE_CHAIN_ENTRY::request& arg, currency_connection_context& context)
   {
+    TRACE_SPAN("p2p::handle_response_chain_entry");
     //do not process requests if it comes from node wich is debugged
     if (m_debug_ip_address != 0 && context.m_remote_ip == m_debug_ip_address)
       return 1;
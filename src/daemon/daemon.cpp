@@ -153,6 +153,7 @@ int main(int argc, char* argv[])
 
   command_line::add_arg(desc_cmd_sett, command_line::arg_log_dir);
   command_line::add_arg(desc_cmd_sett, command_line::arg_log_level);
+  command_line::add_arg(desc_cmd_sett, command_line::arg_log_async);
   command_line::add_arg(desc_cmd_sett, command_line::arg_console);
   command_line::add_arg(desc_cmd_only, command_line::arg_show_details);
   command_line::add_arg(desc_cmd_only, command_line::arg_show_rpc_autodoc);
@@ -230,6 +231,8 @@ int main(int argc, char* argv[])
   }
 
   log_space::log_singletone::add_logger(LOGGER_FILE, log_file_name.c_str(), log_dir.c_str());
+  if (command_line::get_arg(vm, command_line::arg_log_async))
+    log_space::log_singletone::enable_async_mode();
   LOG_PRINT_L0(CURRENCY_NAME << " v" << PROJECT_VERSION_LONG);
 
   if (command_line_preprocessor(vm))
@@ -426,6 +429,7 @@ int main(int argc, char* argv[])
   cprotocol.set_p2p_endpoint(NULL);
 
   LOG_PRINT("Node stopped.", LOG_LEVEL_0);
+  log_space::log_singletone::disable_async_mode();
   return EXIT_SUCCESS;
 
       CATCH_ENTRY_L0(__func__, EXIT_FAILURE);
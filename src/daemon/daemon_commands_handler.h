@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <fstream>
 #include <boost/lexical_cast.hpp>
 #include <boost/bind/placeholders.hpp>
 
@@ -17,6 +18,7 @@
 #include "warnings.h"
 #include "currency_core/bc_offers_service.h"
 #include "serialization/binary_utils.h"
+#include "profile_tools.h"
 #include "simplewallet/password_container.h"
 
 namespace ph = boost::placeholders;
@@ -46,6 +48,7 @@ public:
     m_cmd_binder.set_handler("print_block", boost::bind(&daemon_commands_handler::print_block, this, ph::_1), "Print block, print_block <block_hash> | <block_height>");
     m_cmd_binder.set_handler("print_block_info", boost::bind(&daemon_commands_handler::print_block_info, this, ph::_1), "Print block info, print_block <block_hash> | <block_height>");
     m_cmd_binder.set_handler("print_tx_prun_info", boost::bind(&daemon_commands_handler::print_tx_prun_info, this, ph::_1), "Print tx prunning info");
+    m_cmd_binder.set_handler("print_pruning_status", boost::bind(&daemon_commands_handler::print_pruning_status, this, ph::_1), "Print progress of background tx pruning");
     m_cmd_binder.set_handler("print_tx", boost::bind(&daemon_commands_handler::print_tx, this, ph::_1), "Print transaction, print_tx <transaction_hash>");
     m_cmd_binder.set_handler("start_mining", boost::bind(&daemon_commands_handler::start_mining, this, ph::_1), "Start mining for specified address, start_mining <addr> [threads=1]");
     m_cmd_binder.set_handler("stop_mining", boost::bind(&daemon_commands_handler::stop_mining, this, ph::_1), "Stop mining");
@@ -60,6 +63,10 @@ public:
     m_cmd_binder.set_handler("force_relay_tx_pool", boost::bind(&daemon_commands_handler::force_relay_tx_pool, this, ph::_1), "re-relay all transactions from pool");
     m_cmd_binder.set_handler("enable_channel", boost::bind(&daemon_commands_handler::enable_channel, this, ph::_1), "Enable specified log channel");
     m_cmd_binder.set_handler("disable_channel", boost::bind(&daemon_commands_handler::disable_channel, this, ph::_1), "Enable specified log channel");
+    m_cmd_binder.set_handler("print_log_stat", boost::bind(&daemon_commands_handler::print_log_stat, this, ph::_1), "Print async logging counters (written/dropped messages)");
+    m_cmd_binder.set_handler("trace_start", boost::bind(&daemon_commands_handler::trace_start, this, ph::_1), "Start recording trace spans, trace_start [<events_per_thread>]");
+    m_cmd_binder.set_handler("trace_stop", boost::bind(&daemon_commands_handler::trace_stop, this, ph::_1), "Stop recording trace spans");
+    m_cmd_binder.set_handler("trace_dump", boost::bind(&daemon_commands_handler::trace_dump, this, ph::_1), "Save last N seconds of trace spans as Chrome trace JSON, trace_dump <seconds> <file_path>");
     m_cmd_binder.set_handler("clear_cache", boost::bind(&daemon_commands_handler::clear_cache, this, ph::_1), "Clear blockchain storage cache");
     m_cmd_binder.set_handler("clear_altblocks", boost::bind(&daemon_commands_handler::clear_altblocks, this, ph::_1), "Clear blockchain storage cache");
     m_cmd_binder.set_handler("truncate_bc", boost::bind(&daemon_commands_handler::truncate_bc, this, ph::_1), "Truncate blockchain to specified height");
@@ -170,6 +177,56 @@ private:
     epee::log_space::log_singletone::disable_channel(args[0]);
     return true;
   }
+  bool print_log_stat(const std::vector<std::string>& args)
+  {
+    epee::log_space::async_log_stats st = epee::log_space::log_singletone::get_async_stats();
+    if (!st.enabled)
+    {
+      std::cout << "Async logging is disabled (use --log-async)" << ENDL;
+      return true;
+    }
+    std::cout << "Async logging: written " << st.written << ", dropped " << st.dropped << ", threads " << st.threads << ENDL;
+    return true;
+  }
+  //--------------------------------------------------------------------------------
+  bool trace_start(const std::vector<std::string>& args)
+  {
+    size_t events_per_thread = TRACE_DEFAULT_EVENTS_PER_THREAD;
+    if (args.size() && !string_tools::get_xtype_from_string(events_per_thread, args[0]))
+    {
+      std::cout << "wrong events_per_thread parameter: " << args[0] << ENDL;
+      return true;
+    }
+    epee::profile_tools::tracer::instance().enable(events_per_thread);
+    std::cout << "Tracing started" << ENDL;
+    return true;
+  }
+  //--------------------------------------------------------------------------------
+  bool trace_stop(const std::vector<std::string>& args)
+  {
+    epee::profile_tools::tracer::instance().disable();
+    std::cout << "Tracing stopped, recorded spans are kept until next trace_dump" << ENDL;
+    return true;
+  }
+  //--------------------------------------------------------------------------------
+  bool trace_dump(const std::vector<std::string>& args)
+  {
+    uint64_t seconds = 0;
+    if (args.size() != 2 || !string_tools::get_xtype_from_string(seconds, args[0]))
+    {
+      std::cout << "usage: trace_dump <seconds> <file_path>" << ENDL;
+      return true;
+    }
+    std::ofstream fs(args[1], std::ios::out | std::ios::trunc);
+    if (!fs.is_open())
+    {
+      std::cout << "failed to open " << args[1] << ENDL;
+      return true;
+    }
+    size_t count = epee::profile_tools::tracer::instance().dump_chrome_trace(seconds, fs);
+    std::cout << count << " trace events saved to " << args[1] << " (open in chrome://tracing or ui.perfetto.dev)" << ENDL;
+    return true;
+  }
 
   bool clear_cache(const std::vector<std::string>& args)
   {
@@ -684,6 +741,22 @@ private:
     return true;
   }
   //--------------------------------------------------------------------------------
+  bool print_pruning_status(const std::vector<std::string>& args)
+  {
+    currency::blockchain_storage& bcs = m_srv.get_payload_object().get_core().get_blockchain_storage();
+    uint64_t pruned_height = bcs.get_pruned_rs_height();
+    uint64_t target_height = bcs.get_pruning_target_height();
+    if (pruned_height >= target_height)
+    {
+      LOG_PRINT_L0("Transaction pruning is up to date, pruned up to height " << pruned_height);
+    }
+    else
+    {
+      LOG_PRINT_L0("Transaction pruning is in progress: height " << pruned_height << " of " << target_height << " (" << (target_height - pruned_height) << " blocks left)");
+    }
+    return true;
+  }
+  //--------------------------------------------------------------------------------
   bool print_tx(const std::vector<std::string>& args)
   {
     if (args.empty())
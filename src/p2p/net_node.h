@@ -17,7 +17,7 @@
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 #include <boost/serialization/version.hpp>
-using namespace boost::placeholders
+using namespace boost::placeholders;
 
 #include "warnings.h"
 #include "net/levin_server_cp2.h"
@@ -25,6 +25,8 @@ namespace currency
     const command_line::arg_descriptor<std::string> arg_rpc_bind_ip    ("rpc-bind-ip", "", "127.0.0.1");
     const command_line::arg_descriptor<std::string> arg_rpc_bind_port  ("rpc-bind-port", "", std::to_string(RPC_DEFAULT_PORT));
     const command_line::arg_descriptor<bool> arg_rpc_ignore_status     ("rpc-ignore-offline", "Let rpc calls despite online/offline status");
+    const command_line::arg_descriptor<bool> arg_rpc_enable_metrics    ("rpc-enable-metrics", "Serve latency histograms in Prometheus text format on /metrics");
+    const command_line::arg_descriptor<uint64_t> arg_rpc_compress_min_size("rpc-compress-min-size", "Compress responses of at least this many bytes when client accepts gzip or deflate, 0 - never", 4096);
   }
   //-----------------------------------------------------------------------------------
   void core_rpc_server::init_options(boost::program_options::options_description& desc)
@@ -32,11 +34,13 @@ namespace currency
     command_line::add_arg(desc, arg_rpc_bind_ip);
     command_line::add_arg(desc, arg_rpc_bind_port);
     command_line::add_arg(desc, arg_rpc_ignore_status);
+    command_line::add_arg(desc, arg_rpc_enable_metrics);
+    command_line::add_arg(desc, arg_rpc_compress_min_size);
   }
   //------------------------------------------------------------------------------------------------------------------------------
   core_rpc_server::core_rpc_server(core& cr, nodetool::node_server<currency::t_currency_protocol_handler<currency::core> >& p2p,
     bc_services::bc_offers_service& of
-    ) :m_core(cr), m_p2p(p2p), m_of(of), m_session_counter(0), m_ignore_status(false)
+    ) :m_core(cr), m_p2p(p2p), m_of(of), m_session_counter(0), m_ignore_status(false), m_enable_metrics(false)
   {}
   //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::handle_command_line(const boost::program_options::variables_map& vm)
@@ -47,6 +51,8 @@ namespace currency
     {
       m_ignore_status = command_line::get_arg(vm, arg_rpc_ignore_status);
     }
+    m_enable_metrics = command_line::get_arg(vm, arg_rpc_enable_metrics);
+    m_net_server.get_config_object().m_compress_min_body_size = static_cast<size_t>(command_line::get_arg(vm, arg_rpc_compress_min_size));
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
@@ -525,8 +531,125 @@ namespace currency
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  void core_rpc_server::collect_latency_histograms(std::list<latency_histogram_entry>& entries)
+  {
+    auto add_entry = [&entries](const std::string& name, const epee::math_helper::latency_histogram& h, uint64_t scale)
+    {
+      entries.push_back(latency_histogram_entry());
+      latency_histogram_entry& e = entries.back();
+      e.name = name;
+      e.count = h.get_count();
+      e.sum = h.get_sum() * scale;
+      e.p50 = h.get_percentile(0.5) * scale;
+      e.p90 = h.get_percentile(0.9) * scale;
+      e.p99 = h.get_percentile(0.99) * scale;
+      e.p999 = h.get_percentile(0.999) * scale;
+      e.max = h.get_max() * scale;
+    };
+
+    const currency::blockchain_storage::performnce_data& pd = m_core.get_blockchain_storage().get_performnce_data();
+    add_entry("core.block_processing_time_0", pd.block_processing_time_0_ms.get_histogram(), 1000);
+#define ADD_BLOCK_CHAIN_HISTOGRAM(field_name)   add_entry("core." #field_name, pd.field_name.get_histogram(), 1);
+    ADD_BLOCK_CHAIN_HISTOGRAM(block_processing_time_1);
+    ADD_BLOCK_CHAIN_HISTOGRAM(target_calculating_time_2);
+    ADD_BLOCK_CHAIN_HISTOGRAM(longhash_calculating_time_3);
+    ADD_BLOCK_CHAIN_HISTOGRAM(insert_time_4);
+    ADD_BLOCK_CHAIN_HISTOGRAM(all_txs_insert_time_5);
+    ADD_BLOCK_CHAIN_HISTOGRAM(etc_stuff_6);
+    ADD_BLOCK_CHAIN_HISTOGRAM(raise_block_core_event);
+    ADD_BLOCK_CHAIN_HISTOGRAM(target_calculating_enum_blocks);
+    ADD_BLOCK_CHAIN_HISTOGRAM(target_calculating_calc);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_check_inputs_time);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_add_one_tx_time);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_process_extra);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_process_attachment);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_process_inputs);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_push_global_index);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_check_exist);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_append_time);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_append_rl_wait);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_append_is_expired);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_store_db);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_check_inputs_prefix_hash);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_check_inputs_attachment_check);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_check_inputs_loop);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_check_inputs_loop_kimage_check);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_check_inputs_loop_ch_in_val_sig);
+    ADD_BLOCK_CHAIN_HISTOGRAM(tx_check_inputs_loop_scan_outputkeys_loop);
+#undef ADD_BLOCK_CHAIN_HISTOGRAM
+
+    const currency::tx_memory_pool::performnce_data& pool_pd = m_core.get_tx_pool().get_performnce_data();
+#define ADD_POOL_HISTOGRAM(field_name)   add_entry("pool." #field_name, pool_pd.field_name.get_histogram(), 1);
+    ADD_POOL_HISTOGRAM(tx_processing_time);
+    ADD_POOL_HISTOGRAM(check_inputs_types_supported_time);
+    ADD_POOL_HISTOGRAM(expiration_validate_time);
+    ADD_POOL_HISTOGRAM(validate_amount_time);
+    ADD_POOL_HISTOGRAM(validate_alias_time);
+    ADD_POOL_HISTOGRAM(check_keyimages_ws_ms_time);
+    ADD_POOL_HISTOGRAM(check_inputs_time);
+    ADD_POOL_HISTOGRAM(begin_tx_time);
+    ADD_POOL_HISTOGRAM(update_db_time);
+    ADD_POOL_HISTOGRAM(db_commit_time);
+#undef ADD_POOL_HISTOGRAM
+
+    const tools::db::basic_db_accessor::performance_data& db_pd = m_core.get_blockchain_storage().get_db_performance_data();
+#define ADD_DB_HISTOGRAM(field_name)   add_entry("db." #field_name, db_pd.field_name.get_histogram(), 1);
+    ADD_DB_HISTOGRAM(backend_get_pod_time);
+    ADD_DB_HISTOGRAM(backend_get_t_time);
+    ADD_DB_HISTOGRAM(get_serialize_t_time);
+    ADD_DB_HISTOGRAM(backend_set_pod_time);
+    ADD_DB_HISTOGRAM(backend_set_t_time);
+    ADD_DB_HISTOGRAM(set_serialize_t_time);
+#undef ADD_DB_HISTOGRAM
+
+    epee::net_utils::http::handlers_latency_stats::instance().enumerate([&](const std::string& name, const epee::math_helper::latency_histogram& h)
+    {
+      add_entry("rpc." + name, h, 1);
+    });
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_performance_histograms(const COMMAND_RPC_GET_PERFORMANCE_HISTOGRAMS::request& req, COMMAND_RPC_GET_PERFORMANCE_HISTOGRAMS::response& res, connection_context& cntx)
+  {
+    collect_latency_histograms(res.histograms);
+    res.status = API_RETURN_CODE_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_metrics(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response_info, connection_context& cntx)
+  {
+    if (!m_enable_metrics)
+    {
+      response_info.m_response_code = 404;
+      response_info.m_response_comment = "Not Found";
+      return true;
+    }
+
+    std::list<latency_histogram_entry> entries;
+    collect_latency_histograms(entries);
+
+    const char* metric_name = CURRENCY_NAME_SHORT_BASE "_latency_microseconds";
+    std::stringstream ss;
+    ss << "# HELP " << metric_name << " Latency of block processing stages, tx checks, db operations and rpc handlers" << "\n";
+    ss << "# TYPE " << metric_name << " summary" << "\n";
+    for (const auto& e : entries)
+    {
+      ss << metric_name << "{name=\"" << e.name << "\",quantile=\"0.5\"} " << e.p50 << "\n";
+      ss << metric_name << "{name=\"" << e.name << "\",quantile=\"0.9\"} " << e.p90 << "\n";
+      ss << metric_name << "{name=\"" << e.name << "\",quantile=\"0.99\"} " << e.p99 << "\n";
+      ss << metric_name << "{name=\"" << e.name << "\",quantile=\"0.999\"} " << e.p999 << "\n";
+      ss << metric_name << "{name=\"" << e.name << "\",quantile=\"1\"} " << e.max << "\n";
+      ss << metric_name << "_sum{name=\"" << e.name << "\"} " << e.sum << "\n";
+      ss << metric_name << "_count{name=\"" << e.name << "\"} " << e.count << "\n";
+    }
+    response_info.m_body = ss.str();
+    response_info.m_mime_tipe = "text/plain; version=0.0.4";
+    response_info.m_header_info.m_content_type = " text/plain; version=0.0.4";
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_rpc_get_blocks_details(const COMMAND_RPC_GET_BLOCKS_DETAILS::request& req, COMMAND_RPC_GET_BLOCKS_DETAILS::response& res, connection_context& cntx)
   {
+    currency::blockchain_storage::read_snapshot rs(m_core.get_blockchain_storage());
     m_core.get_blockchain_storage().get_main_blocks_rpc_details(req.height_start, req.count, req.ignore_transactions, res.blocks);
     res.status = API_RETURN_CODE_OK;
     return true;
@@ -541,6 +664,7 @@ namespace currency
       error_resp.message = "Invalid tx hash given";
       return false;
     }
+    currency::blockchain_storage::read_snapshot rs(m_core.get_blockchain_storage());
     if (!m_core.get_blockchain_storage().get_tx_rpc_details(h, res.tx_info, 0, false))
     {
       if (!m_core.get_tx_pool().get_transaction_details(h, res.tx_info))
@@ -561,6 +685,7 @@ namespace currency
     if (!epee::string_tools::hex_to_pod(req.id, id))
       return false;
 
+    currency::blockchain_storage::read_snapshot rs(m_core.get_blockchain_storage());
     m_core.get_blockchain_storage().search_by_id(id, res.types_found);
     res.status = API_RETURN_CODE_OK;
     return true;
@@ -568,6 +693,7 @@ namespace currency
   //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_out_info(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES_BY_AMOUNT::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES_BY_AMOUNT::response& res, connection_context& cntx)
   {
+    currency::blockchain_storage::read_snapshot rs(m_core.get_blockchain_storage());
     if (!m_core.get_blockchain_storage().get_global_index_details(req, res))
       res.status = API_RETURN_CODE_NOT_FOUND;
     else
@@ -577,6 +703,7 @@ namespace currency
   //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_multisig_info(const COMMAND_RPC_GET_MULTISIG_INFO::request& req, COMMAND_RPC_GET_MULTISIG_INFO::response& res, connection_context& cntx)
   {
+    currency::blockchain_storage::read_snapshot rs(m_core.get_blockchain_storage());
     if (!m_core.get_blockchain_storage().get_multisig_id_details(req, res))
       res.status = API_RETURN_CODE_NOT_FOUND;
     else
@@ -633,6 +760,7 @@ namespace currency
   //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_main_block_details(const COMMAND_RPC_GET_BLOCK_DETAILS::request& req, COMMAND_RPC_GET_BLOCK_DETAILS::response& res, epee::json_rpc::error& error_resp, connection_context& cntx)
   {
+    currency::blockchain_storage::read_snapshot rs(m_core.get_blockchain_storage());
     if (!m_core.get_blockchain_storage().get_main_block_rpc_details(req.id, res.block_details))
     {
       error_resp.code = CORE_RPC_ERROR_CODE_NOT_FOUND;
@@ -946,7 +1074,7 @@ namespace currency
         error_resp.message = "Wrong explicit tx blob";
         return false;
       }
-      bvc.m_onboard_transactions[tx_hash] = tx;
+      bvc.m_onboard_transactions[tx_hash] = std::move(tx);
     }
 
 
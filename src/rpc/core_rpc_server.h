@@ -90,6 +90,8 @@ namespace currency
     bool on_get_alt_block_details(const COMMAND_RPC_GET_BLOCK_DETAILS::request& req, COMMAND_RPC_GET_BLOCK_DETAILS::response& res, epee::json_rpc::error& error_resp, connection_context& cntx);
     bool on_get_alt_blocks_details(const COMMAND_RPC_GET_ALT_BLOCKS_DETAILS::request& req, COMMAND_RPC_GET_ALT_BLOCKS_DETAILS::response& res, connection_context& cntx);
     bool on_get_est_height_from_date(const COMMAND_RPC_GET_EST_HEIGHT_FROM_DATE::request& req, COMMAND_RPC_GET_EST_HEIGHT_FROM_DATE::response& res, connection_context& cntx);
+    bool on_get_performance_histograms(const COMMAND_RPC_GET_PERFORMANCE_HISTOGRAMS::request& req, COMMAND_RPC_GET_PERFORMANCE_HISTOGRAMS::response& res, connection_context& cntx);
+    bool on_get_metrics(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response_info, connection_context& cntx);
     
     
     
@@ -114,6 +116,8 @@ namespace currency
       MAP_URI_AUTO_JON2("/start_mining",              on_start_mining,                COMMAND_RPC_START_MINING)
       MAP_URI_AUTO_JON2("/stop_mining",               on_stop_mining,                 COMMAND_RPC_STOP_MINING)
       MAP_URI_AUTO_JON2("/getinfo",                   on_get_info,                    COMMAND_RPC_GET_INFO)
+      // prometheus text exposition, enabled by --rpc-enable-metrics
+      MAP_URI_RAW2("/metrics",                        on_get_metrics)
       // binary RPCs
       MAP_URI_AUTO_BIN2("/getblocks.bin",             on_get_blocks,                  COMMAND_RPC_GET_BLOCKS_FAST)
       MAP_URI_AUTO_BIN2("/get_o_indexes.bin",         on_get_indexes,                 COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES)      
@@ -157,6 +161,7 @@ namespace currency
         //
         MAP_JON_RPC   ("reset_transaction_pool",      on_reset_transaction_pool,      COMMAND_RPC_RESET_TX_POOL)
         MAP_JON_RPC   ("get_current_core_tx_expiration_median", on_get_current_core_tx_expiration_median, COMMAND_RPC_GET_CURRENT_CORE_TX_EXPIRATION_MEDIAN)
+        MAP_JON_RPC   ("get_performance_histograms",  on_get_performance_histograms,  COMMAND_RPC_GET_PERFORMANCE_HISTOGRAMS)
         //
         MAP_JON_RPC_WE("marketplace_global_get_offers_ex",               on_get_offers_ex,               COMMAND_RPC_GET_OFFERS_EX)
         //remote miner rpc
@@ -173,6 +178,7 @@ namespace currency
     bool check_core_ready_(const std::string& calling_method);
     bool get_job(const std::string& job_id, mining::job_details& job, epee::json_rpc::error& err, connection_context& cntx);
     bool get_current_hi(mining::height_info& hi);
+    void collect_latency_histograms(std::list<latency_histogram_entry>& entries);
 
     //utils
     uint64_t get_block_reward(const block& blk);
@@ -186,6 +192,7 @@ namespace currency
     std::string m_port;
     std::string m_bind_ip;
     bool m_ignore_status;
+    bool m_enable_metrics;
     //mining stuff
     epee::critical_section m_session_jobs_lock;
     std::map<std::string, currency::block> m_session_jobs; //session id -> blob
@@ -597,6 +597,49 @@ namespace currency
     END_KV_SERIALIZE_MAP()
   };
 
+  struct latency_histogram_entry
+  {
+    std::string name;
+    uint64_t count;
+    uint64_t sum;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(name)
+      KV_SERIALIZE(count)
+      KV_SERIALIZE(sum)
+      KV_SERIALIZE(p50)
+      KV_SERIALIZE(p90)
+      KV_SERIALIZE(p99)
+      KV_SERIALIZE(p999)
+      KV_SERIALIZE(max)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct COMMAND_RPC_GET_PERFORMANCE_HISTOGRAMS
+  {
+    struct request
+    {
+      BEGIN_KV_SERIALIZE_MAP()
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response
+    {
+      std::string status;
+      std::list<latency_histogram_entry> histograms; // all values are in microseconds
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(status)
+        KV_SERIALIZE(histograms)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
 
   //-----------------------------------------------
 
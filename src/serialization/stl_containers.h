@@ -31,6 +31,24 @@ namespace serialization
       ar.serialize_varint(e);
       return true;
     }
+
+    // loads next element right into the vector's own storage, avoiding deep copy of every element (vin/vout/signatures)
+    template <typename Archive, class T>
+    bool serialize_container_element_to_back(Archive& ar, std::vector<T>& v)
+    {
+      v.push_back(T());
+      return serialize_container_element(ar, v.back());
+    }
+
+    template <typename Archive>
+    bool serialize_container_element_to_back(Archive& ar, std::vector<bool>& v)
+    {
+      bool b = false;
+      if (!serialize_container_element(ar, b))
+        return false;
+      v.push_back(b);
+      return true;
+    }
   }
 }
 
@@ -54,12 +72,10 @@ bool do_serialize(Archive<false> &ar, std::vector<T> &v)
     if (i > 0)
       ar.delimit_array();
     
-    T t = T();
-    if (!::serialization::detail::serialize_container_element(ar, t))
+    if (!::serialization::detail::serialize_container_element_to_back(ar, v))
       return false;
     if (!ar.stream().good())
       return false;
-    v.push_back(t);
   }
   ar.end_array();
   return true;
@@ -156,7 +172,7 @@ bool do_serialize(Archive<false> &ar, std::set<T> &v)
       return false;
     if (!ar.stream().good())
       return false;
-    v.insert(t);
+    v.insert(std::move(t));
   }
   ar.end_array();
   return true;
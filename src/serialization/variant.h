@@ -42,7 +42,7 @@ struct variant_reader
         ar.stream().setstate(std::ios::failbit);
         return false;
       }
-      v = x;
+      v = std::move(x);
     } else {
       return variant_reader<Archive, Variant, TNext, TEnd>::read(ar, v, t);
     }
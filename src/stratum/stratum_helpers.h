@@ -7,10 +7,11 @@
 #include <string>
 #include "epee/include/misc_language.h"
 #include "epee/include/storages/parserse_base_utils.h"
-#include "epee/include/storages/portable_storage.h"
+#include "epee/include/storages/json_on_demand_reader.h"
 #include "ethereum/libethash/ethash/ethash.h"
 #include "ethereum/libethash/ethash/keccak.h"
 #include "currency_core/currency_format_utils.h"
+#include "currency_core/basic_pow_helpers.h"
 
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/version.hpp>
@@ -82,7 +83,7 @@ namespace stratum
   };
 
   template<class t_value>
-  bool ps_get_value_noexcept(epee::serialization::portable_storage& ps, const std::string& value_name, t_value& val, epee::serialization::portable_storage::hsection hparent_section)
+  bool ps_get_value_noexcept(epee::serialization::json_on_demand_reader& ps, const std::string& value_name, t_value& val, epee::serialization::json_on_demand_reader::hsection hparent_section)
   {
     try
     {
@@ -213,6 +214,48 @@ namespace stratum
 	  return UINT64_MAX;
   }
 
+  //------------------------------------------------------------------------------------------------------------------------------
+
+  // Immutable snapshot of the current work. A new object is created on every block template update and swapped in,
+  // so shares can be checked on any server thread without holding the work change lock during PoW hashing.
+  struct stratum_job
+  {
+    stratum_job()
+      : ethash(currency::null_hash)
+      , prev_ethash(currency::null_hash)
+      , height(0)
+      , network_difficulty(0)
+    {}
+
+    currency::block block_template;
+    crypto::hash ethash;        // header hash the workers are mining on
+    crypto::hash prev_ethash;   // previous job's header hash, shares for it are considered stale
+    uint64_t height;
+    currency::wide_difficulty_type network_difficulty;
+  };
+
+  enum share_check_result
+  {
+    share_wrong_job,
+    share_stale,
+    share_low_difficulty,
+    share_ok,                   // enough for worker difficulty
+    share_block_found           // enough for network difficulty as well
+  };
+
+  inline share_check_result check_share(const stratum_job& job, uint64_t nonce, const crypto::hash& block_ethash, const currency::wide_difficulty_type& worker_difficulty, crypto::hash& block_pow_hash)
+  {
+    if (block_ethash != job.ethash)
+      return block_ethash == job.prev_ethash ? share_stale : share_wrong_job;
+
+    block_pow_hash = currency::get_block_longhash(job.height, job.ethash, nonce);
+    if (!currency::check_hash(block_pow_hash, worker_difficulty))
+      return share_low_difficulty;
+    if (!currency::check_hash(block_pow_hash, job.network_difficulty))
+      return share_ok;
+    return share_block_found;
+  }
+
   //------------------------------------------------------------------------------------------------------------------------------
   
   // http://www.jsonrpc.org/specification  
@@ -245,7 +288,7 @@ namespace stratum
     };
   }
 
-  bool read_jsonrpc_id(epee::serialization::portable_storage& ps, jsonrpc_id_t& result)
+  bool read_jsonrpc_id(epee::serialization::json_on_demand_reader& ps, jsonrpc_id_t& result)
   {
     epee::serialization::storage_entry se;
     if (!ps.get_value("id", se, nullptr))
@@ -19,6 +19,10 @@
 #include <boost/serialization/library_version_type.hpp>
 #endif
 #include <boost/serialization/list.hpp>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
 
 #undef LOG_DEFAULT_CHANNEL 
 #define LOG_DEFAULT_CHANNEL "stratum"
@@ -297,6 +301,41 @@ namespace
     vdiff_params_t m_vd_params;
   }; // struct stratum_connection_context
 
+//==============================================================================================================================
+  // One work update being delivered to all workers. Each worker's notification is sent from its connection's strand,
+  // the last one to complete reports how long it took since the update was started.
+  struct work_broadcast
+  {
+    typedef std::function<void(uint64_t /* latency, us */, size_t /* workers */)> finished_callback_t;
+
+    explicit work_broadcast(const finished_callback_t& cb)
+      : started(std::chrono::steady_clock::now())
+      , workers_count(0)
+      , pending(1) // held by the broadcasting thread until all notifications are posted
+      , on_finished(cb)
+    {}
+
+    void add_one()
+    {
+      ++workers_count;
+      ++pending;
+    }
+
+    void finish_one()
+    {
+      if (--pending != 0)
+        return;
+      uint64_t latency_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+      if (on_finished)
+        on_finished(latency_us, workers_count);
+    }
+
+    const std::chrono::steady_clock::time_point started;
+    std::atomic<size_t> workers_count;
+    std::atomic<size_t> pending;
+    finished_callback_t on_finished;
+  };
+
 //==============================================================================================================================
   template<typename connection_context_t>
   class stratum_protocol_handler;
@@ -307,14 +346,22 @@ namespace
     typedef stratum_protocol_handler_config<connection_context_t> this_t;
     typedef stratum_protocol_handler<connection_context_t> protocol_handler_t;
 
+    struct protocol_handler_entry
+    {
+      protocol_handler_t* p_ph;
+      boost::weak_ptr<typename protocol_handler_t::connection_t> connection; // lock() it to use p_ph outside of m_ph_map_lock
+    };
+    typedef std::unordered_map<boost::uuids::uuid, protocol_handler_entry, boost::hash<boost::uuids::uuid> > protocol_handlers_map;
+
     stratum_protocol_handler_config()
       : m_max_packet_size(10240)
       , m_p_core(nullptr)
-      , m_network_difficulty(0)
+      , m_protocol_handlers(std::make_shared<protocol_handlers_map>())
+      , m_last_work_broadcast_latency_us(0)
+      , m_last_work_broadcast_workers(0)
       , m_miner_addr(null_pub_addr)
-      , m_block_template_ethash(null_hash)
+      , m_job(std::make_shared<stratum_job>())
       , m_blockchain_last_block_id(null_hash)
-      , m_block_template_height(0)
       , m_block_template_update_ts(0)
       , m_last_ts_total_hr_was_printed(epee::misc_utils::get_tick_count())
       , m_total_hr_print_interval_ms(STRATUM_TOTAL_HR_PRINT_INTERVAL_S_DEFAULT * 1000)
@@ -345,8 +392,11 @@ namespace
 
     void add_protocol_handler(protocol_handler_t* p_ph)
     {
+      protocol_handler_entry entry = { p_ph, p_ph->get_connection_weak_ptr() };
       CRITICAL_REGION_BEGIN(m_ph_map_lock);
-      m_protocol_handlers[p_ph->get_context().m_connection_id] = p_ph;
+      std::shared_ptr<protocol_handlers_map> new_map = std::make_shared<protocol_handlers_map>(*m_protocol_handlers);
+      (*new_map)[p_ph->get_context().m_connection_id] = entry;
+      m_protocol_handlers = new_map;
       CRITICAL_REGION_END();
       LOG_PRINT_CC(p_ph->get_context(), "stratum_protocol_handler_config: protocol handler added", LOG_LEVEL_4);
       //m_pcommands_handler->on_connection_new(pconn->m_connection_context);
@@ -355,7 +405,9 @@ namespace
     void remove_protocol_handler(protocol_handler_t* p_ph)
     {
       CRITICAL_REGION_BEGIN(m_ph_map_lock);
-      m_protocol_handlers.erase(p_ph->get_context().m_connection_id);
+      std::shared_ptr<protocol_handlers_map> new_map = std::make_shared<protocol_handlers_map>(*m_protocol_handlers);
+      new_map->erase(p_ph->get_context().m_connection_id);
+      m_protocol_handlers = new_map;
       CRITICAL_REGION_END();
       LOG_PRINT_CC(p_ph->get_context(), "stratum_protocol_handler_config: protocol handler removed", LOG_LEVEL_4);
       //m_pcommands_handler->on_connection_close(pconn->m_connection_context);
@@ -397,26 +449,30 @@ namespace
         return false;// no new blocks since last update, keep the same work
       
       LOG_PRINT("stratum_protocol_handler_config::update_block_template(" << (enforce_update ? "true" : "false") << ")", LOG_LEVEL_4);
-      m_block_template = AUTO_VAL_INIT(m_block_template);
+      std::shared_ptr<stratum_job> job = std::make_shared<stratum_job>();
       wide_difficulty_type block_template_difficulty;
       blobdata extra = AUTO_VAL_INIT(extra);
-      bool r = m_p_core->get_block_template(m_block_template, m_miner_addr, m_miner_addr, block_template_difficulty, m_block_template_height, extra);
+      bool r = m_p_core->get_block_template(job->block_template, m_miner_addr, m_miner_addr, block_template_difficulty, job->height, extra);
       CHECK_AND_ASSERT_MES(r, false, "get_block_template failed");
 #if DBG_NETWORK_DIFFICULTY == 0
-      m_network_difficulty = block_template_difficulty;
+      job->network_difficulty = block_template_difficulty;
 #else
-      m_network_difficulty = DBG_NETWORK_DIFFICULTY; // for debug purpose only
+      job->network_difficulty = DBG_NETWORK_DIFFICULTY; // for debug purpose only
 #endif
       m_blockchain_last_block_id = top_block_id;
 
-      m_block_template_hash_blob = get_block_hashing_blob(m_block_template);
-      if (access_nonce_in_block_blob(m_block_template_hash_blob) != 0)
+      blobdata hash_blob = get_block_hashing_blob(job->block_template);
+      if (access_nonce_in_block_blob(hash_blob) != 0)
       {
         LOG_PRINT_RED("non-zero nonce in generated block template", LOG_LEVEL_0);
-        access_nonce_in_block_blob(m_block_template_hash_blob) = 0;
+        access_nonce_in_block_blob(hash_blob) = 0;
       }
-      m_prev_block_template_ethash = m_block_template_ethash;
-      m_block_template_ethash = crypto::cn_fast_hash(m_block_template_hash_blob.data(), m_block_template_hash_blob.size());
+      job->prev_ethash = get_job()->ethash;
+      job->ethash = crypto::cn_fast_hash(hash_blob.data(), hash_blob.size());
+
+      CRITICAL_REGION_BEGIN(m_job_lock);
+      m_job = job;
+      CRITICAL_REGION_END();
       m_block_template_update_ts = epee::misc_utils::get_tick_count();
 
       set_work_for_all_workers(); // notify all workers of updated work
@@ -424,32 +480,75 @@ namespace
       return true;
     }
 
+    // Iterates a snapshot of connections, so connecting/disconnecting workers are not blocked. Job JSON is built once per
+    // distinct worker difficulty, actual sending is posted to each connection's strand and done by the server threads.
     void set_work_for_all_workers(protocol_handler_t* ph_to_skip = nullptr)
     {
       LOG_PRINT("stratum_protocol_handler_config::set_work_for_all_workers()", LOG_LEVEL_4);
-      CRITICAL_REGION_LOCAL(m_ph_map_lock);
-      for (auto& ph : m_protocol_handlers)
+      std::shared_ptr<const protocol_handlers_map> handlers = get_protocol_handlers();
+      std::shared_ptr<const stratum_job> job = get_job();
+      bool is_synchronized = is_core_syncronized();
+      std::shared_ptr<work_broadcast> broadcast = std::make_shared<work_broadcast>([this](uint64_t latency_us, size_t workers) { on_work_broadcast_finished(latency_us, workers); });
+
+      std::map<wide_difficulty_type, std::string> work_json_by_difficulty;
+      for (auto& h : *handlers)
       {
-        if (ph.second == ph_to_skip)
+        protocol_handler_t* p_ph = h.second.p_ph;
+        if (p_ph == ph_to_skip)
           continue;
-        ph.second->get_context().adjust_worker_difficulty_if_needed(); // some miners seem to not give a f*ck about updated job taget if the block hash wasn't changed, so change difficulty only on work update
-        std::string new_work_json = get_work_json(ph.second->get_context().get_worker_difficulty());
-        ph.second->set_work(new_work_json);
-        ph.second->send_notification(new_work_json);
+        auto connection_ptr = h.second.connection.lock(); // keeps the handler alive till the end of this iteration
+        if (!connection_ptr)
+          continue; // being disconnected
+
+        p_ph->get_context().adjust_worker_difficulty_if_needed(); // some miners seem to not give a f*ck about updated job taget if the block hash wasn't changed, so change difficulty only on work update
+        wide_difficulty_type worker_difficulty = p_ph->get_context().get_worker_difficulty();
+        auto it = work_json_by_difficulty.find(worker_difficulty);
+        if (it == work_json_by_difficulty.end())
+          it = work_json_by_difficulty.insert(std::make_pair(worker_difficulty, is_synchronized ? get_work_json(*job, worker_difficulty) : std::string(R"("result":[])"))).first;
+
+        broadcast->add_one();
+        p_ph->post_work_notification(it->second, broadcast);
       }
+      broadcast->finish_one();
     }
 
     std::string get_work_json(const wide_difficulty_type& worker_difficulty)
     {
-      CRITICAL_REGION_LOCAL(m_work_change_lock);
       if (!is_core_syncronized())
         return R"("result":[])";
 
+      return get_work_json(*get_job(), worker_difficulty);
+    }
+
+    static std::string get_work_json(const stratum_job& job, const wide_difficulty_type& worker_difficulty)
+    {
       crypto::hash target_boundary = null_hash;
       difficulty_to_boundary_long(worker_difficulty, target_boundary);
 
-      ethash_hash256 seed_hash = ethash_calculate_epoch_seed(ethash_height_to_epoch(m_block_template_height));
-      return R"("result":[")" + pod_to_net_format(m_block_template_ethash) + R"(",")" + pod_to_net_format(seed_hash) + R"(",")" + pod_to_net_format_reverse(target_boundary) + R"(",")" + pod_to_net_format_reverse(m_block_template_height) + R"("])";
+      ethash_hash256 seed_hash = ethash_calculate_epoch_seed(ethash_height_to_epoch(job.height));
+      return R"("result":[")" + pod_to_net_format(job.ethash) + R"(",")" + pod_to_net_format(seed_hash) + R"(",")" + pod_to_net_format_reverse(target_boundary) + R"(",")" + pod_to_net_format_reverse(job.height) + R"("])";
+    }
+
+    void on_work_broadcast_finished(uint64_t latency_us, size_t workers_count)
+    {
+      if (workers_count == 0)
+        return;
+      m_work_broadcast_latency.push(latency_us);
+      m_last_work_broadcast_latency_us = latency_us;
+      m_last_work_broadcast_workers = workers_count;
+      LOG_PRINT_L2("new work delivered to " << workers_count << " worker(s) in " << latency_us << " us");
+    }
+
+    std::shared_ptr<const protocol_handlers_map> get_protocol_handlers() const
+    {
+      CRITICAL_REGION_LOCAL(m_ph_map_lock);
+      return m_protocol_handlers;
+    }
+
+    std::shared_ptr<const stratum_job> get_job() const
+    {
+      CRITICAL_REGION_LOCAL(m_job_lock);
+      return m_job;
     }
 
     void update_work(protocol_handler_t* p_ph)
@@ -469,9 +568,10 @@ namespace
         p_ph->set_work(get_work_json(p_ph->get_context().get_worker_difficulty()));
     }
 
+    // Called concurrently from stratum server threads. Only the job snapshot is taken under the lock, so PoW hashing
+    // of different workers' shares runs in parallel and doesn't delay block template updates.
     bool handle_work(protocol_handler_t* p_ph, const jsonrpc_id_t& id, const std::string& worker, uint64_t nonce, const crypto::hash& block_ethash)
     {
-      CRITICAL_REGION_LOCAL(m_work_change_lock);
       bool r = false;
 
       if (!is_core_syncronized())
@@ -481,31 +581,32 @@ namespace
         p_ph->send_response_default(id);
         return true;
       }
-  
-      const uint64_t height = get_block_height(m_block_template);
 
-      // make sure worker sent work with correct block ethash
-      if (block_ethash != m_block_template_ethash)
+      std::shared_ptr<const stratum_job> job = get_job();
+      const uint64_t height = job->height;
+      wide_difficulty_type worker_difficulty = p_ph->get_context().get_worker_difficulty();
+      crypto::hash block_pow_hash = null_hash;
+      share_check_result share_res = check_share(*job, nonce, block_ethash, worker_difficulty, block_pow_hash);
+
+      if (share_res == share_stale)
       {
-        if (block_ethash == m_prev_block_template_ethash)
-        {
-          // Got stale share, do nothing. In future it can be used for more aggressive mining strategies
-          LP_CC_WORKER_BLUE(p_ph->get_context(), "got stale share, skip it", LOG_LEVEL_1);
-          p_ph->send_response_default(id);
-          p_ph->get_context().increment_stale_shares_count();
-          return true;
-        }
+        // Got stale share, do nothing. In future it can be used for more aggressive mining strategies
+        LP_CC_WORKER_BLUE(p_ph->get_context(), "got stale share, skip it", LOG_LEVEL_1);
+        p_ph->send_response_default(id);
+        p_ph->get_context().increment_stale_shares_count();
+        return true;
+      }
 
-        LP_CC_WORKER_RED(p_ph->get_context(), "wrong work submitted, ethhash " << block_ethash << ", expected: " << m_block_template_ethash, LOG_LEVEL_0);
+      if (share_res == share_wrong_job)
+      {
+        // make sure worker sent work with correct block ethash
+        LP_CC_WORKER_RED(p_ph->get_context(), "wrong work submitted, ethhash " << block_ethash << ", expected: " << job->ethash, LOG_LEVEL_0);
         p_ph->send_response_error(id, JSONRPC_ERROR_CODE_DEFAULT, "wrong work");
         p_ph->get_context().increment_wrong_shares_count();
         return false;
       }
 
-      crypto::hash block_pow_hash = get_block_longhash(height, m_block_template_ethash, nonce);
-      wide_difficulty_type worker_difficulty = p_ph->get_context().get_worker_difficulty();
-
-      if (!check_hash(block_pow_hash, worker_difficulty))
+      if (share_res == share_low_difficulty)
       {
         LP_CC_WORKER_RED(p_ph->get_context(), "block pow hash " << block_pow_hash << " doesn't meet worker difficulty: " << worker_difficulty << ENDL <<
           "nonce: " << nonce << " (0x" << epee::string_tools::pod_to_hex(nonce) << ")", LOG_LEVEL_0);
@@ -518,7 +619,7 @@ namespace
       p_ph->get_context().increment_normal_shares_count();
       m_shares_per_minute.chick();
 
-      if (!check_hash(block_pow_hash, m_network_difficulty))
+      if (share_res == share_ok)
       {
         // work is enough for worker difficulty, but not enough for network difficulty -- it's okay, move on!
         LP_CC_WORKER_GREEN(p_ph->get_context(), "share found for difficulty " << worker_difficulty << ", nonce: 0x" << epee::string_tools::pod_to_hex(nonce), LOG_LEVEL_1);
@@ -528,22 +629,24 @@ namespace
       }
 
       // seems we've just found a block!
-      // create a block template and push it to the core
-      m_block_template.nonce = nonce;
-      crypto::hash block_hash = get_block_hash(m_block_template);
+      // create a block from the job's template and push it to the core
+      block b = job->block_template;
+      b.nonce = nonce;
+      crypto::hash block_hash = get_block_hash(b);
 
-      LP_CC_WORKER_GREEN(p_ph->get_context(), "block found " << block_hash << " at height " << height << " for difficulty " << m_network_difficulty << " pow: " << block_pow_hash << ENDL <<
+      LP_CC_WORKER_GREEN(p_ph->get_context(), "block found " << block_hash << " at height " << height << " for difficulty " << job->network_difficulty << " pow: " << block_pow_hash << ENDL <<
         "nonce: " << nonce << " (0x" << epee::string_tools::pod_to_hex(nonce) << ")", LOG_LEVEL_1);
 
       block_verification_context bvc = AUTO_VAL_INIT(bvc);
-      r = m_p_core->handle_block_found(m_block_template, &bvc, false);
+      r = m_p_core->handle_block_found(b, &bvc, false);
       if (r)
       {
         if (!bvc.m_verification_failed && !bvc.m_added_to_altchain && bvc.m_added_to_main_chain && !bvc.m_already_exists && !bvc.m_marked_as_orphaned)
         {
-          LP_CC_WORKER_GREEN(p_ph->get_context(), "found block " << block_hash << " at height " << height << " was successfully added to the blockchain, difficulty " << m_network_difficulty, LOG_LEVEL_0);
+          LP_CC_WORKER_GREEN(p_ph->get_context(), "found block " << block_hash << " at height " << height << " was successfully added to the blockchain, difficulty " << job->network_difficulty, LOG_LEVEL_0);
           r = update_block_template();
-          CHECK_AND_ASSERT_MES_NO_RET(r, "Stratum: internal error. Block template wasn't updated as expected after handling found block.");
+          // another thread could have already switched to the new template
+          CHECK_AND_ASSERT_MES_NO_RET(r || get_job() != job, "Stratum: internal error. Block template wasn't updated as expected after handling found block.");
           p_ph->get_context().increment_blocks_count();
           ++m_total_blocks_found;
         }
@@ -633,7 +736,7 @@ namespace
     {
       LOG_PRINT_L4("stratum_protocol_handler_config::on_send_stop_signal()");
       CRITICAL_REGION_LOCAL(m_ph_map_lock);
-      m_protocol_handlers.clear();
+      m_protocol_handlers = std::make_shared<protocol_handlers_map>();
     }
 
     // i_blockchain_update_listener member
@@ -702,8 +805,8 @@ namespace
         LOG_PRINT_L0("Blockchain is synchronizing...");
       }
 
-      CRITICAL_REGION_LOCAL(m_ph_map_lock);
-      if (m_protocol_handlers.empty())
+      std::shared_ptr<const protocol_handlers_map> handlers = get_protocol_handlers();
+      if (handlers->empty())
       {
         LOG_PRINT_CYAN("Blocks found: [" << m_total_blocks_found << "], no miners connected", LOG_LEVEL_0);
       }
@@ -711,17 +814,22 @@ namespace
       {
         std::stringstream ss;
         uint64_t total_reported_hr = 0, total_estimated_hr = 0;
-        for (auto& ph : m_protocol_handlers)
+        for (auto& h : *handlers)
         {
+          auto connection_ptr = h.second.connection.lock();
+          if (!connection_ptr)
+            continue;
           uint64_t reported_hr = 0, estimated_hr = 0;
-          ph.second->get_hashrate(reported_hr, estimated_hr);
+          h.second.p_ph->get_hashrate(reported_hr, estimated_hr);
           total_reported_hr += reported_hr;
           total_estimated_hr += estimated_hr;
-          ss << ph.second->get_context().m_worker_name << ": [" << ph.second->get_context().get_blocks_count() << "] " << HR_TO_STREAM_IN_MHS_1P(reported_hr) << " (" << HR_TO_STREAM_IN_MHS_1P(estimated_hr) << "), ";
+          ss << h.second.p_ph->get_context().m_worker_name << ": [" << h.second.p_ph->get_context().get_blocks_count() << "] " << HR_TO_STREAM_IN_MHS_1P(reported_hr) << " (" << HR_TO_STREAM_IN_MHS_1P(estimated_hr) << "), ";
         }
         auto s = ss.str();
         LOG_PRINT_CYAN("Blocks found: [" << m_total_blocks_found << "], total speed: " << HR_TO_STREAM_IN_MHS_3P(total_reported_hr) << " Mh/s as reported by miners (" << HR_TO_STREAM_IN_MHS_3P(total_estimated_hr) << " Mh/s estimated by the server), current shares/min: " << m_shares_per_minute.get_speed() << ENDL <<
-          m_protocol_handlers.size() << " worker(s): " << s.substr(0, s.length() > 2 ? s.length() - 2 : 0), LOG_LEVEL_0);
+          "new work delivery to all workers: last " << m_last_work_broadcast_latency_us << " us (" << m_last_work_broadcast_workers << " workers), p50 " << m_work_broadcast_latency.get_percentile(0.5) <<
+          " us, p99 " << m_work_broadcast_latency.get_percentile(0.99) << " us, max " << m_work_broadcast_latency.get_max() << " us" << ENDL <<
+          handlers->size() << " worker(s): " << s.substr(0, s.length() > 2 ? s.length() - 2 : 0), LOG_LEVEL_0);
       }
 
       m_last_ts_total_hr_was_printed = epee::misc_utils::get_tick_count();
@@ -747,27 +855,23 @@ namespace
     size_t m_max_packet_size;
 
   private:
-    typedef std::unordered_map<boost::uuids::uuid, protocol_handler_t* , boost::hash<boost::uuids::uuid> > protocol_handlers_map;
     typedef epee::math_helper::speed<60 * 1000 /* ms */> shares_per_minute_rate_t;
 
-    protocol_handlers_map m_protocol_handlers;
+    std::shared_ptr<const protocol_handlers_map> m_protocol_handlers; // copy-on-write, replaced as a whole under m_ph_map_lock
     mutable epee::critical_section m_ph_map_lock;
+    epee::math_helper::latency_histogram m_work_broadcast_latency; // us, from work update start till the last worker is notified
+    std::atomic<uint64_t> m_last_work_broadcast_latency_us;
+    std::atomic<size_t> m_last_work_broadcast_workers;
     mutable epee::critical_section m_work_change_lock;
     mutable epee::critical_section m_generic_lock;
 
     // job data
-    block m_block_template;
-    std::string m_block_template_hash_blob;
-    crypto::hash m_block_template_ethash;
+    std::shared_ptr<const stratum_job> m_job; // never modified, replaced as a whole under m_job_lock
+    mutable epee::critical_section m_job_lock;
     crypto::hash m_blockchain_last_block_id;
-    uint64_t m_block_template_height;
     std::atomic<uint64_t> m_block_template_update_ts;
 
-    // previous job (for handling stale shares)
-    crypto::hash m_prev_block_template_ethash;
-
     vdiff_params_t m_vdiff_params;
-    wide_difficulty_type m_network_difficulty;
 
     core* m_p_core;
     account_public_address m_miner_addr; // all workers will share the same miner address
@@ -775,7 +879,7 @@ namespace
     uint64_t m_total_hr_print_interval_ms;
     uint64_t m_block_template_update_pediod_ms;
     size_t m_nameless_worker_id;
-    size_t m_total_blocks_found;
+    std::atomic<size_t> m_total_blocks_found;
     shares_per_minute_rate_t m_shares_per_minute;
     bool m_is_core_always_online;
 
@@ -843,7 +947,7 @@ namespace
         std::string json;
         while (m_json_helper.pop_object(json))
         {
-          epee::serialization::portable_storage ps;
+          epee::serialization::json_on_demand_reader ps;
           if (ps.load_from_json(json))
           {
             if (!handle_json_request(ps, json))
@@ -861,7 +965,7 @@ namespace
       return true;
     }
 
-    bool handle_json_request(epee::serialization::portable_storage& ps, const std::string& json)
+    bool handle_json_request(epee::serialization::json_on_demand_reader& ps, const std::string& json)
     {
       std::stringstream error_stream;
       jsonrpc_id_t id = jsonrpc_id_null;
@@ -870,7 +974,7 @@ namespace
       std::string method;
       if (ps_get_value_noexcept(ps, "method", method, nullptr))
       {
-        epee::serialization::portable_storage::hsection params_section = ps.open_section("params", nullptr);
+        epee::serialization::json_on_demand_reader::hsection params_section = ps.open_section("params", nullptr);
         auto handler_it = m_methods_handlers.find(method);
         if (handler_it == m_methods_handlers.end())
         {
@@ -889,7 +993,7 @@ namespace
       {
         std::string error;
         ps_get_value_noexcept(ps, "error", error, nullptr);
-        epee::serialization::portable_storage::hsection error_section = ps.open_section("error", nullptr);
+        epee::serialization::json_on_demand_reader::hsection error_section = ps.open_section("error", nullptr);
         if (error_section != nullptr || !error.empty())
         {
           LP_CC_WORKER_RED(m_context, "received an error: " << json, LOG_LEVEL_1);
@@ -912,10 +1016,10 @@ namespace
       }
     }
 
-    bool handle_method_eth_submitLogin(const jsonrpc_id_t& id, epee::serialization::portable_storage& ps, epee::serialization::portable_storage::hsection params_section)
+    bool handle_method_eth_submitLogin(const jsonrpc_id_t& id, epee::serialization::json_on_demand_reader& ps, epee::serialization::json_on_demand_reader::hsection params_section)
     {
       std::string user_str, pass_str;
-      epee::serialization::harray params_array = ps.get_first_value("params", user_str, nullptr);
+      epee::serialization::json_on_demand_reader::harray params_array = ps.get_first_value("params", user_str, nullptr);
       if (params_array != nullptr)
         ps.get_next_value(params_array, pass_str);
 
@@ -940,7 +1044,7 @@ namespace
       return m_config.handle_login(this, id, user_str, pass_str, worker_str, start_difficulty);
     }
 
-    bool handle_method_eth_getWork(const jsonrpc_id_t& id, epee::serialization::portable_storage& ps, epee::serialization::portable_storage::hsection params_section)
+    bool handle_method_eth_getWork(const jsonrpc_id_t& id, epee::serialization::json_on_demand_reader& ps, epee::serialization::json_on_demand_reader::hsection params_section)
     {
       m_config.update_work(this);
 
@@ -951,10 +1055,10 @@ namespace
       return true;
     }
 
-    bool handle_method_eth_submitHashrate(const jsonrpc_id_t& id, epee::serialization::portable_storage& ps, epee::serialization::portable_storage::hsection params_section)
+    bool handle_method_eth_submitHashrate(const jsonrpc_id_t& id, epee::serialization::json_on_demand_reader& ps, epee::serialization::json_on_demand_reader::hsection params_section)
     {
       std::string rate_str, rate_submit_id_str;
-      epee::serialization::harray params_array = ps.get_first_value("params", rate_str, nullptr);
+      epee::serialization::json_on_demand_reader::harray params_array = ps.get_first_value("params", rate_str, nullptr);
       bool r = params_array != nullptr && ps.get_next_value(params_array, rate_submit_id_str);
       CHECK_AND_ASSERT_MES(r, false, "Incorrect parameters");
 
@@ -968,11 +1072,11 @@ namespace
       return m_config.handle_submit_hashrate(this, rate_128.low, rate_submit_id);
     }
 
-    bool handle_method_eth_submitWork(const jsonrpc_id_t& id, epee::serialization::portable_storage& ps, epee::serialization::portable_storage::hsection params_section)
+    bool handle_method_eth_submitWork(const jsonrpc_id_t& id, epee::serialization::json_on_demand_reader& ps, epee::serialization::json_on_demand_reader::hsection params_section)
     {
       bool r = true;
       std::string nonce_str, header_str, mixhash_str;
-      epee::serialization::harray params_array = ps.get_first_value("params", nonce_str, nullptr);
+      epee::serialization::json_on_demand_reader::harray params_array = ps.get_first_value("params", nonce_str, nullptr);
       r = params_array != nullptr && ps.get_next_value(params_array, header_str);
       r = params_array != nullptr && ps.get_next_value(params_array, mixhash_str);
       CHECK_AND_ASSERT_MES(r, false, "Incorrect parameters");
@@ -1020,6 +1124,22 @@ namespace
       send_response(id, R"("error":{"code":)" + std::to_string(error_code) + R"(,"message":")" + error_message + R"("})");
     }
 
+    // queues work notification to be sent from this connection's strand by one of the server threads
+    void post_work_notification(const std::string& json, const std::shared_ptr<work_broadcast>& broadcast)
+    {
+      std::shared_ptr<work_broadcast> superseded;
+      CRITICAL_REGION_BEGIN(m_work_change_lock);
+      m_pending_work_json = json;
+      superseded = m_pending_work_broadcast;
+      m_pending_work_broadcast = broadcast;
+      CRITICAL_REGION_END();
+      if (superseded)
+        superseded->finish_one(); // previous work wasn't sent yet and never will be
+
+      if (!static_cast<epee::net_utils::i_service_endpoint*>(m_p_connection)->request_callback())
+        handle_qued_callback(); // connection is going down, just release the broadcast
+    }
+
     void set_work(const std::string& json)
     {
       CRITICAL_REGION_LOCAL(m_work_change_lock);
@@ -1033,6 +1153,18 @@ namespace
     // required member for epee::net_utils::boosted_tcp_server concept
     void handle_qued_callback()
     {
+      std::string json;
+      std::shared_ptr<work_broadcast> broadcast;
+      CRITICAL_REGION_BEGIN(m_work_change_lock);
+      json.swap(m_pending_work_json);
+      broadcast.swap(m_pending_work_broadcast);
+      CRITICAL_REGION_END();
+      if (!broadcast)
+        return; // already sent by previous callback
+
+      set_work(json);
+      send_notification(json);
+      broadcast->finish_one();
     }
 
     // required member for epee::net_utils::boosted_tcp_server concept
@@ -1060,6 +1192,8 @@ namespace
     connection_context_t& get_context() { return m_context; }
     const connection_context_t& get_context() const { return m_context; }
 
+    boost::weak_ptr<connection_t> get_connection_weak_ptr() { return m_p_connection->weak_from_this(); }
+
     void get_hashrate(uint64_t& last_reported_hr, uint64_t& estimated_hr)
     {
       last_reported_hr = m_last_reported_hashrate;
@@ -1074,11 +1208,13 @@ namespace
 
     json_helper m_json_helper;
     std::string m_cached_work_json;
+    std::string m_pending_work_json;                        // work notification waiting for handle_qued_callback()
+    std::shared_ptr<work_broadcast> m_pending_work_broadcast;
 
     epee::critical_section m_work_change_lock;
     uint64_t m_last_reported_hashrate;
 
-    typedef bool (this_t::*method_handler_func_t)(const jsonrpc_id_t& id, epee::serialization::portable_storage& ps, epee::serialization::portable_storage::hsection params_section);
+    typedef bool (this_t::*method_handler_func_t)(const jsonrpc_id_t& id, epee::serialization::json_on_demand_reader& ps, epee::serialization::json_on_demand_reader::hsection params_section);
     static std::unordered_map<std::string, method_handler_func_t> m_methods_handlers;
     
     std::atomic<bool> m_connection_initialized;
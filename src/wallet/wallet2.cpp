@@ -189,6 +189,11 @@ bool wallet2::set_core_proxy(const std::shared_ptr<i_core_proxy>& proxy)
   return true;
 }
 //----------------------------------------------------------------------------------------------------
+void wallet2::set_refresh_scheduler(const std::shared_ptr<wallet_refresh_scheduler>& scheduler)
+{
+  m_refresh_scheduler = scheduler;
+}
+//----------------------------------------------------------------------------------------------------
 void wallet2::set_pos_mint_packing_size(uint64_t new_size)
 {
   m_pos_mint_packing_size = new_size;
@@ -1576,7 +1581,7 @@ void wallet2::pull_blocks(size_t& blocks_added, std::atomic<bool>& stop)
     m_height_of_start_sync = req.minimum_height;
 
   m_chain.get_short_chain_history(req.block_ids);
-  bool r = m_core_proxy->call_COMMAND_RPC_GET_BLOCKS_DIRECT(req, res);
+  bool r = m_refresh_scheduler ? m_refresh_scheduler->call_COMMAND_RPC_GET_BLOCKS_DIRECT(req, res) : m_core_proxy->call_COMMAND_RPC_GET_BLOCKS_DIRECT(req, res);
   if (!r)
     throw error::no_connection_to_daemon(LOCATION_STR, "getblocks.bin");
   if (res.status == API_RETURN_CODE_GENESIS_MISMATCH)
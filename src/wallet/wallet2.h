@@ -39,6 +39,7 @@
 #include "crypto/hash.h"
 #include "core_rpc_proxy.h"
 #include "core_default_rpc_proxy.h"
+#include "wallet_refresh_scheduler.h"
 #include "wallet_errors.h"
 #include "eos/portable_archive.hpp"
 #include "currency_core/core_runtime_config.h"
@@ -549,6 +550,7 @@ namespace tools
     
 
     bool set_core_proxy(const std::shared_ptr<i_core_proxy>& proxy);
+    void set_refresh_scheduler(const std::shared_ptr<wallet_refresh_scheduler>& scheduler);
     void set_pos_mint_packing_size(uint64_t new_size);
     void set_minimum_height(uint64_t h);
     std::shared_ptr<i_core_proxy> get_core_proxy();
@@ -1057,6 +1059,7 @@ private:
     std::unordered_map<crypto::hash, uint64_t> m_active_htlcs_txid; // map [txid] -> transfer index, limitation: 1 transactiom -> 1 htlc
 
     std::shared_ptr<i_core_proxy> m_core_proxy;
+    std::shared_ptr<wallet_refresh_scheduler> m_refresh_scheduler; // shared between wallets of one process, optional
     std::shared_ptr<i_wallet2_callback> m_wcallback;
     uint64_t m_height_of_start_sync;
     std::atomic<uint64_t> m_last_sync_percent;
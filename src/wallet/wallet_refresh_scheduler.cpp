@@ -0,0 +1,145 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet_refresh_scheduler.h"
+
+namespace tools
+{
+  wallet_refresh_scheduler::wallet_refresh_scheduler(std::shared_ptr<i_core_proxy> proxy, const std::atomic<uint64_t>* plast_daemon_height, size_t max_cached_batches)
+    : m_proxy(proxy)
+    , m_plast_daemon_height(plast_daemon_height)
+    , m_max_cached_batches(max_cached_batches ? max_cached_batches : 1)
+    , m_fetched_from_daemon(0)
+    , m_served_from_shared(0)
+  {}
+  //----------------------------------------------------------------------------------------------------
+  std::string wallet_refresh_scheduler::make_request_key(const currency::COMMAND_RPC_GET_BLOCKS_DIRECT::request& rqt)
+  {
+    std::string key;
+    key.reserve(sizeof(uint64_t) + 1 + rqt.block_ids.size() * sizeof(crypto::hash));
+    key.append(reinterpret_cast<const char*>(&rqt.minimum_height), sizeof(rqt.minimum_height));
+    key.push_back(rqt.need_global_indexes ? 1 : 0);
+    for (const auto& id : rqt.block_ids)
+      key.append(reinterpret_cast<const char*>(&id), sizeof(id));
+    return key;
+  }
+  //----------------------------------------------------------------------------------------------------
+  bool wallet_refresh_scheduler::is_reusable(const batch_entry& e) const
+  {
+    if (!e.ready)
+      return true; // in flight, just wait for it
+    if (!e.ok || e.rsp.status != API_RETURN_CODE_OK)
+      return false;
+    // batch fetched before daemon got new blocks would make wallet believe it's synchronized
+    if (m_plast_daemon_height && e.rsp.current_height < m_plast_daemon_height->load())
+      return false;
+    return true;
+  }
+  //----------------------------------------------------------------------------------------------------
+  void wallet_refresh_scheduler::trim_cache()
+  {
+    while (m_batches_order.size() > m_max_cached_batches)
+    {
+      auto it = m_batches.find(m_batches_order.front());
+      if (it != m_batches.end() && it->second->ready)
+        m_batches.erase(it);
+      m_batches_order.pop_front();
+    }
+  }
+  //----------------------------------------------------------------------------------------------------
+  bool wallet_refresh_scheduler::call_COMMAND_RPC_GET_BLOCKS_DIRECT(const currency::COMMAND_RPC_GET_BLOCKS_DIRECT::request& rqt, currency::COMMAND_RPC_GET_BLOCKS_DIRECT::response& rsp)
+  {
+    std::string key = make_request_key(rqt);
+    std::shared_ptr<batch_entry> entry;
+    {
+      std::unique_lock<std::mutex> lk(m_lock);
+      auto it = m_batches.find(key);
+      if (it != m_batches.end() && is_reusable(*it->second))
+      {
+        entry = it->second;
+        m_batch_ready.wait(lk, [&]() { return entry->ready; });
+        if (entry->ok)
+        {
+          rsp = entry->rsp; // blocks are shared_ptr-s, so this doesn't copy block data
+          m_served_from_shared++;
+          return true;
+        }
+        return false;
+      }
+
+      // nobody fetched this batch yet (or cached one is outdated), do it ourselves
+      entry.reset(new batch_entry());
+      if (it != m_batches.end())
+      {
+        it->second = entry;
+        m_batches_order.remove(key);
+      }
+      else
+      {
+        m_batches[key] = entry;
+      }
+      m_batches_order.push_back(key);
+    }
+
+    bool r = false;
+    currency::COMMAND_RPC_GET_BLOCKS_DIRECT::response local_rsp = AUTO_VAL_INIT(local_rsp);
+    try
+    {
+      r = m_proxy->call_COMMAND_RPC_GET_BLOCKS_DIRECT(rqt, local_rsp);
+    }
+    catch (...)
+    {
+      std::unique_lock<std::mutex> lk(m_lock);
+      entry->ready = true;
+      m_batches.erase(key);
+      m_batch_ready.notify_all();
+      throw;
+    }
+    m_fetched_from_daemon++;
+
+    {
+      std::unique_lock<std::mutex> lk(m_lock);
+      entry->ok = r;
+      entry->rsp = local_rsp;
+      entry->ready = true;
+      if (!r || local_rsp.status != API_RETURN_CODE_OK)
+      {
+        auto it = m_batches.find(key);
+        if (it != m_batches.end() && it->second == entry)
+          m_batches.erase(it);
+      }
+      trim_cache();
+    }
+    m_batch_ready.notify_all();
+
+    rsp = std::move(local_rsp);
+    return r;
+  }
+  //----------------------------------------------------------------------------------------------------
+  wallet_refresh_scheduler::stats wallet_refresh_scheduler::get_stats() const
+  {
+    stats s = AUTO_VAL_INIT(s);
+    s.fetched_from_daemon = m_fetched_from_daemon;
+    s.served_from_shared = m_served_from_shared;
+    return s;
+  }
+  //----------------------------------------------------------------------------------------------------
+  void wallet_refresh_scheduler::clear()
+  {
+    std::unique_lock<std::mutex> lk(m_lock);
+    m_batches_order.clear();
+    for (auto it = m_batches.begin(); it != m_batches.end();)
+    {
+      if (it->second->ready)
+      {
+        it = m_batches.erase(it);
+      }
+      else
+      {
+        m_batches_order.push_back(it->first);
+        ++it;
+      }
+    }
+  }
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "core_rpc_proxy.h"
+
+#define WALLET_REFRESH_SCHEDULER_MAX_CACHED_BATCHES        32
+
+namespace tools
+{
+  /*
+    Shares GET_BLOCKS_DIRECT results between wallets hosted in one process.
+    Wallets that are at the same point of the chain send identical requests (same short chain history),
+    so only the first one goes to the daemon, the rest wait for it and get a copy of the response
+    (block entries are held by shared_ptr, so copy is cheap and blocks are deserialized only once).
+    Each wallet still scans in its own thread and keeps its own height.
+  */
+  class wallet_refresh_scheduler
+  {
+  public:
+    struct stats
+    {
+      uint64_t fetched_from_daemon;
+      uint64_t served_from_shared;
+    };
+
+    wallet_refresh_scheduler(std::shared_ptr<i_core_proxy> proxy, const std::atomic<uint64_t>* plast_daemon_height = nullptr, size_t max_cached_batches = WALLET_REFRESH_SCHEDULER_MAX_CACHED_BATCHES);
+
+    bool call_COMMAND_RPC_GET_BLOCKS_DIRECT(const currency::COMMAND_RPC_GET_BLOCKS_DIRECT::request& rqt, currency::COMMAND_RPC_GET_BLOCKS_DIRECT::response& rsp);
+    stats get_stats() const;
+    void clear();
+
+  private:
+    struct batch_entry
+    {
+      batch_entry() :ready(false), ok(false), rsp() {}
+      bool ready;
+      bool ok;
+      currency::COMMAND_RPC_GET_BLOCKS_DIRECT::response rsp;
+    };
+
+    static std::string make_request_key(const currency::COMMAND_RPC_GET_BLOCKS_DIRECT::request& rqt);
+    bool is_reusable(const batch_entry& e) const;
+    void trim_cache();
+
+    std::shared_ptr<i_core_proxy> m_proxy;
+    const std::atomic<uint64_t>* m_plast_daemon_height;
+    size_t m_max_cached_batches;
+
+    mutable std::mutex m_lock;
+    std::condition_variable m_batch_ready;
+    std::map<std::string, std::shared_ptr<batch_entry>> m_batches;
+    std::list<std::string> m_batches_order; // oldest first
+    std::atomic<uint64_t> m_fetched_from_daemon;
+    std::atomic<uint64_t> m_served_from_shared;
+  };
+}
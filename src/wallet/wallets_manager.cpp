@@ -89,6 +89,7 @@ wallets_manager::wallets_manager():m_pview(&m_view_stub),
   m_offers_service.set_disabled(true);
   m_pproxy_diganostic_info = m_rpc_proxy->get_proxy_diagnostic_info();
 #endif
+  m_refresh_scheduler.reset(new tools::wallet_refresh_scheduler(m_rpc_proxy, &m_last_daemon_height));
 	//m_ccore.get_blockchain_storage().get_attachment_services_manager().add_service(&m_offers_service);
 }
 
@@ -355,6 +356,7 @@ bool wallets_manager::init(view::i_view* pview_handler)
     m_rpc_proxy.reset(proxy_ptr);    
     m_rpc_proxy->set_connection_addr(command_line::get_arg(m_vm, arg_remote_node));
     m_pproxy_diganostic_info = m_rpc_proxy->get_proxy_diagnostic_info();
+    m_refresh_scheduler.reset(new tools::wallet_refresh_scheduler(m_rpc_proxy, &m_last_daemon_height));
   }
 
   if(!command_line::has_arg(m_vm, arg_disable_logs_init))
@@ -943,6 +945,7 @@ std::string wallets_manager::open_wallet(const std::wstring& path, const std::st
     LOG_ERROR("Unexpected location reached");
 #endif
   }
+  w->set_refresh_scheduler(m_refresh_scheduler);
   
   std::string return_code = API_RETURN_CODE_OK;
   while (true)
@@ -1062,6 +1065,7 @@ std::string wallets_manager::generate_wallet(const std::wstring& path, const std
     LOG_ERROR("Unexpected location reached");
 #endif
   }
+  w->set_refresh_scheduler(m_refresh_scheduler);
 
   try
   {
@@ -1169,6 +1173,7 @@ std::string wallets_manager::restore_wallet(const std::wstring& path, const std:
 #endif
 
   }
+  w->set_refresh_scheduler(m_refresh_scheduler);
 
   currency::account_base acc;
   try
@@ -199,6 +199,7 @@ private:
   view::i_view m_view_stub;
   view::i_view* m_pview;
   std::shared_ptr<tools::i_core_proxy> m_rpc_proxy;
+  std::shared_ptr<tools::wallet_refresh_scheduler> m_refresh_scheduler; // lets wallets at the same height share fetched blocks
   po::variables_map m_vm;
 
   bool m_use_deffered_global_outputs;
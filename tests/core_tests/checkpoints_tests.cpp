@@ -40,6 +40,11 @@ bool checkpoints_test::set_checkpoint(currency::core& c, size_t ev_index, const
       c.set_checkpoints(currency::checkpoints(m_local_checkpoints));
       LOG_PRINT_YELLOW("CHECKPOINT set at height " << pcp.height, LOG_LEVEL_0);
 
+      // tx pruning is done in background by core's idle loop, complete it here
+      blockchain_storage& bcs = c.get_blockchain_storage();
+      while (bcs.get_pruned_rs_height() < bcs.get_pruning_target_height())
+        CHECK_AND_ASSERT_MES(bcs.prune_ring_signatures_and_attachments_if_need(), false, "tx pruning failed");
+
       //for(uint64_t h = 0; h <= pcp.height + 1; ++h)
       //  LOG_PRINT_MAGENTA("%% " << h << " : " << m_local_checkpoints.get_checkpoint_before_height(h), LOG_LEVEL_0);
       return true;
@@ -114,6 +114,11 @@ bool prun_ring_signatures::set_check_points(currency::core& c, size_t ev_index,
   currency::checkpoints cp;
   cp.add_checkpoint(currency::get_block_height(b), epee::string_tools::pod_to_hex(currency::get_block_hash(b)));
   c.set_checkpoints(std::move(cp));
+
+  // tx pruning is done in background by core's idle loop, complete it here
+  currency::blockchain_storage& bcs = c.get_blockchain_storage();
+  while (bcs.get_pruned_rs_height() < bcs.get_pruning_target_height())
+    CHECK_AND_ASSERT_MES(bcs.prune_ring_signatures_and_attachments_if_need(), false, "tx pruning failed");
   return true;
 }
 bool prun_ring_signatures::check_blockchain(currency::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
@@ -0,0 +1,79 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <functional>
+
+#include "include_base_utils.h"
+#include "profile_tools.h"
+#include "serialization/keyvalue_serialization.h"
+#include "storages/portable_storage_template_helper.h"
+#include "currency_protocol/currency_protocol_defs.h"
+#include "binary_kv_serialization_test.h"
+
+namespace
+{
+  // runs cb repeat_count times, prints ops/sec and MB/sec of processed binary
+  void measure(const std::string& name, size_t repeat_count, size_t buff_size, const std::function<bool()>& cb)
+  {
+    TIME_MEASURE_START(t);
+    for (size_t i = 0; i != repeat_count; i++)
+    {
+      if (!cb())
+      {
+        LOG_ERROR(name << ": failed");
+        return;
+      }
+    }
+    TIME_MEASURE_FINISH(t);
+    double sec = t ? t / 1000000.0 : 0.000001;
+    LOG_PRINT_L0(std::left << std::setw(48) << name << std::right << std::setw(10) << static_cast<uint64_t>(repeat_count / sec) << " ops/s, "
+      << std::setw(8) << std::fixed << std::setprecision(1) << repeat_count * buff_size / sec / (1024 * 1024) << " MB/s");
+  }
+
+  template<class t_struct>
+  void measure_struct(const std::string& name, const t_struct& obj, size_t repeat_count)
+  {
+    std::string binary = epee::serialization::store_t_to_binary(obj);
+    std::string buff;
+    LOG_PRINT_L0(name << ", " << binary.size() << " bytes:");
+    measure("  store (portable_storage)", repeat_count, binary.size(), [&]() { epee::serialization::portable_storage ps; obj.store(ps); return ps.store_to_binary(buff); });
+    measure("  store_t_to_binary (binary_flat_writer)", repeat_count, binary.size(), [&]() { return epee::serialization::store_t_to_binary(obj, buff); });
+    measure("  load (portable_storage)", repeat_count, binary.size(), [&]() { t_struct o = AUTO_VAL_INIT(o); epee::serialization::portable_storage ps; return ps.load_from_binary(binary) && o.load(ps); });
+    measure("  load_t_from_binary (binary_on_demand_reader)", repeat_count, binary.size(), [&]() { t_struct o = AUTO_VAL_INIT(o); return epee::serialization::load_t_from_binary(o, binary); });
+  }
+}
+
+bool do_binary_kv_serialization_test()
+{
+  // p2p sync data, sent with every handshake and timed sync
+  currency::CORE_SYNC_DATA sync_data = AUTO_VAL_INIT(sync_data);
+  sync_data.current_height = 2000000;
+  sync_data.top_id = crypto::cn_fast_hash("top", 3);
+  sync_data.last_checkpoint_height = 1900000;
+  sync_data.core_time = 1700000000;
+  sync_data.client_version = "2.0.0.333[abcdef0]";
+  measure_struct("CORE_SYNC_DATA", sync_data, 200000);
+
+  // a batch of blocks as downloaded during sync
+  currency::NOTIFY_RESPONSE_GET_OBJECTS::request objects = AUTO_VAL_INIT(objects);
+  for (uint64_t i = 0; i != 200; i++)
+  {
+    currency::block_complete_entry bce = AUTO_VAL_INIT(bce);
+    bce.block = std::string(300, static_cast<char>(i));
+    for (uint64_t j = 0; j != 5; j++)
+    {
+      bce.txs.push_back(std::string(2000, static_cast<char>(j)));
+      currency::struct_with_one_t_type<std::vector<uint64_t> > outs = AUTO_VAL_INIT(outs);
+      for (uint64_t k = 0; k != 4; k++)
+        outs.v.push_back(i * 1000 + j * 10 + k);
+      bce.tx_global_outs.push_back(outs);
+    }
+    bce.coinbase_global_outs = { i, i + 1 };
+    objects.blocks.push_back(bce);
+  }
+  objects.current_blockchain_height = 2000000;
+  measure_struct("NOTIFY_RESPONSE_GET_OBJECTS, 200 blocks", objects, 500);
+
+  return true;
+}
@@ -0,0 +1,122 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <functional>
+#include <vector>
+
+#include "include_base_utils.h"
+#include "profile_tools.h"
+#include "serialization/keyvalue_serialization.h"
+#include "storages/portable_storage_template_helper.h"
+#include "net/http_server_handlers_map2.h"
+#include "rpc/core_rpc_server_commands_defs.h"
+#include "json_kv_serialization_test.h"
+
+namespace
+{
+  struct bench_tx_entry
+  {
+    std::string id;
+    uint64_t amount;
+    uint64_t height;
+    bool is_mixable;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(id)
+      KV_SERIALIZE(amount)
+      KV_SERIALIZE(height)
+      KV_SERIALIZE(is_mixable)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct bench_tx_list
+  {
+    std::vector<bench_tx_entry> txs;
+    std::list<uint64_t> indexes;
+    std::string status;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(txs)
+      KV_SERIALIZE(indexes)
+      KV_SERIALIZE(status)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  // runs cb repeat_count times, prints ops/sec and MB/sec of processed json
+  void measure(const std::string& name, size_t repeat_count, size_t json_size, const std::function<bool()>& cb)
+  {
+    TIME_MEASURE_START(t);
+    for (size_t i = 0; i != repeat_count; i++)
+    {
+      if (!cb())
+      {
+        LOG_ERROR(name << ": failed");
+        return;
+      }
+    }
+    TIME_MEASURE_FINISH(t);
+    double sec = t ? t / 1000000.0 : 0.000001;
+    LOG_PRINT_L0(std::left << std::setw(48) << name << std::right << std::setw(10) << static_cast<uint64_t>(repeat_count / sec) << " ops/s, "
+      << std::setw(8) << std::fixed << std::setprecision(1) << repeat_count * json_size / sec / (1024 * 1024) << " MB/s");
+  }
+
+  template<class t_struct>
+  void measure_struct(const std::string& name, const t_struct& obj, size_t repeat_count)
+  {
+    std::string json = epee::serialization::store_t_to_json(obj);
+    std::string buff;
+    LOG_PRINT_L0(name << ", " << json.size() << " bytes:");
+    measure("  store_t_to_json (portable_storage)", repeat_count, json.size(), [&]() { return epee::serialization::store_t_to_json(obj, buff); });
+    measure("  store_t_to_json_stream", repeat_count, json.size(), [&]() { return epee::serialization::store_t_to_json_stream(obj, buff); });
+    measure("  load_t_from_json (portable_storage)", repeat_count, json.size(), [&]() { t_struct o = AUTO_VAL_INIT(o); return epee::serialization::load_t_from_json(o, json); });
+    measure("  load_t_from_json_on_demand", repeat_count, json.size(), [&]() { t_struct o = AUTO_VAL_INIT(o); return epee::serialization::load_t_from_json_on_demand(o, json); });
+  }
+
+  template<class t_storage>
+  bool read_submit_work(const std::string& json)
+  {
+    t_storage ps;
+    if (!ps.load_from_json(json))
+      return false;
+    std::string method, nonce, header, mixhash;
+    epee::serialization::storage_entry id;
+    ps.get_value("id", id, nullptr);
+    if (!ps.get_value("method", method, nullptr))
+      return false;
+    auto params_array = ps.get_first_value("params", nonce, nullptr);
+    return params_array != nullptr && ps.get_next_value(params_array, header) && ps.get_next_value(params_array, mixhash);
+  }
+}
+
+bool do_json_kv_serialization_test()
+{
+  // stratum share submission, as sent by ethminer
+  std::string submit_work = R"({"id":4,"jsonrpc":"2.0","method":"eth_submitWork","params":["0x8e1a3d2e3c4b5a69","0x92bab4097740fd0d9ab36abd219f36dd0654a229bab2f509ea6f07b619013da1","0x0000000000000000000000000000000000000000000000000000000000000000"],"worker":"rig1"})";
+  LOG_PRINT_L0("stratum eth_submitWork, " << submit_work.size() << " bytes:");
+  measure("  portable_storage", 200000, submit_work.size(), [&]() { return read_submit_work<epee::serialization::portable_storage>(submit_work); });
+  measure("  json_on_demand_reader", 200000, submit_work.size(), [&]() { return read_submit_work<epee::serialization::json_on_demand_reader>(submit_work); });
+
+  // typical small JSON-RPC response
+  epee::json_rpc::response<currency::COMMAND_RPC_GET_INFO::response, epee::json_rpc::dummy_error> info = AUTO_VAL_INIT(info);
+  info.jsonrpc = "2.0";
+  info.id = epee::serialization::storage_entry(uint64_t(1));
+  info.result.status = API_RETURN_CODE_OK;
+  info.result.height = 123456;
+  info.result.pos_difficulty = "1234567890123456";
+  info.result.default_fee = 10000000000;
+  measure_struct("getinfo JSON-RPC response", info, 20000);
+
+  // big list response
+  bench_tx_list list = AUTO_VAL_INIT(list);
+  for (uint64_t i = 0; i != 1000; i++)
+  {
+    bench_tx_entry e = { epee::string_tools::pod_to_hex(crypto::cn_fast_hash(&i, sizeof i)), i * 1000000000000, 100000 + i, i % 2 == 0 };
+    list.txs.push_back(e);
+    list.indexes.push_back(i * 17);
+  }
+  list.status = API_RETURN_CODE_OK;
+  measure_struct("list of 1000 entries", list, 200);
+
+  return true;
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cstdint>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "include_base_utils.h"
+#include "logging_performance_test.h"
+
+namespace
+{
+  const size_t disabled_lines_count = 10000000;
+  const size_t enabled_lines_count = 200000;
+
+  // logs at LOG_LEVEL_3 so lines reach only the file logger (console is limited to LOG_LEVEL_2 in main)
+  void log_lines(size_t count)
+  {
+    for (size_t i = 0; i != count; i++)
+    {
+      LOG_PRINT_L3("logging performance test line " << i << ", some payload: " << 0xdeadbeef << ", tx_id: <3d1f9a3c0c6f0c12a2f6c46d7fbdcb3f2d2a6b42fc1a3c1fe7d6cf0ec1fb3a01>");
+    }
+  }
+
+  uint64_t measure_lines_ns(size_t threads_count, size_t count_per_thread)
+  {
+    auto started = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i != threads_count; i++)
+      threads.push_back(std::thread([count_per_thread]() { log_lines(count_per_thread); }));
+    for (auto& th : threads)
+      th.join();
+    auto elapsed = std::chrono::high_resolution_clock::now() - started;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+  }
+
+  void print_result(const char* name, size_t threads_count, size_t count_per_thread, uint64_t elapsed_ns)
+  {
+    std::cout << std::left << std::setw(40) << name << " threads: " << threads_count
+      << ", lines: " << threads_count * count_per_thread
+      << ", " << elapsed_ns / 1000000 << " ms, "
+      << static_cast<double>(elapsed_ns) / (threads_count * count_per_thread) << " ns/line (per thread)" << std::endl;
+  }
+}
+
+bool do_logging_performance_test()
+{
+  int prev_level = epee::log_space::get_set_log_detalisation_level();
+  size_t threads_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+  epee::log_space::get_set_log_detalisation_level(true, LOG_LEVEL_2);
+  print_result("disabled line", 1, disabled_lines_count, measure_lines_ns(1, disabled_lines_count));
+
+  epee::log_space::get_set_log_detalisation_level(true, LOG_LEVEL_3);
+  print_result("enabled line, sync", 1, enabled_lines_count, measure_lines_ns(1, enabled_lines_count));
+  print_result("enabled line, sync", threads_count, enabled_lines_count, measure_lines_ns(threads_count, enabled_lines_count));
+
+  epee::log_space::log_singletone::enable_async_mode();
+  print_result("enabled line, async", 1, enabled_lines_count, measure_lines_ns(1, enabled_lines_count));
+  print_result("enabled line, async", threads_count, enabled_lines_count, measure_lines_ns(threads_count, enabled_lines_count));
+  epee::log_space::log_singletone::disable_async_mode();
+
+  epee::log_space::async_log_stats st = epee::log_space::log_singletone::get_async_stats();
+  std::cout << "async: written " << st.written << ", dropped " << st.dropped << std::endl;
+
+  epee::log_space::get_set_log_detalisation_level(true, prev_level);
+  return true;
+}
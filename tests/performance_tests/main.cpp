@@ -24,6 +24,10 @@
 #include "free_space_check.h"
 #include "htlc_hash_tests.h"
 #include "threads_pool_tests.h"
+#include "logging_performance_test.h"
+#include "stratum_share_validation_test.h"
+#include "json_kv_serialization_test.h"
+#include "binary_kv_serialization_test.h"
 
 
 int main(int argc, char** argv)
@@ -52,6 +56,10 @@ int main(int argc, char** argv)
 // 
 //   
   //do_htlc_hash_tests();
+  //do_logging_performance_test();
+  //do_stratum_share_validation_test();
+  //do_json_kv_serialization_test();
+  //do_binary_kv_serialization_test();
   //run_serialization_performance_test();
   //return 1;
   //run_core_market_performance_tests(100000);
@@ -0,0 +1,100 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "include_base_utils.h"
+#include "stratum/stratum_helpers.h"
+#include "stratum_share_validation_test.h"
+
+namespace
+{
+  const size_t shares_per_worker = 20;
+
+  std::shared_ptr<const stratum::stratum_job> make_job(uint64_t seed)
+  {
+    std::shared_ptr<stratum::stratum_job> job(new stratum::stratum_job());
+    job->height = 1;
+    job->network_difficulty = 1000000000000ull;
+    *reinterpret_cast<uint64_t*>(&job->ethash) = seed;
+    return job;
+  }
+
+  // every worker submits shares_per_worker shares, workers are spread over threads_count threads
+  // (as connections are spread over stratum server threads); returns shares/sec
+  template<class validate_t>
+  double measure_shares_per_sec(size_t threads_count, size_t workers_count, validate_t validate)
+  {
+    std::atomic<size_t> next_worker(0);
+    std::atomic<size_t> accepted(0);
+    auto started = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i != threads_count; i++)
+    {
+      threads.push_back(std::thread([&]() {
+        for (size_t w = next_worker++; w < workers_count; w = next_worker++)
+          for (uint64_t n = 0; n != shares_per_worker; n++)
+            if (validate((uint64_t(w) << 32) + n) >= stratum::share_ok)
+              ++accepted;
+      }));
+    }
+    for (auto& th : threads)
+      th.join();
+    double elapsed_s = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - started).count();
+    if (accepted != workers_count * shares_per_worker)
+      std::cout << "WARNING: only " << accepted << " of " << workers_count * shares_per_worker << " shares accepted" << std::endl;
+    return workers_count * shares_per_worker / elapsed_s;
+  }
+}
+
+bool do_stratum_share_validation_test()
+{
+  size_t hw_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  std::shared_ptr<const stratum::stratum_job> job = make_job(1);
+
+  std::set<size_t> threads_counts = { 1, 2, hw_threads, hw_threads * 2 };
+
+  std::cout << "stratum share validation, " << shares_per_worker << " shares per worker" << std::endl;
+  for (size_t workers_count : { 16, 256, 1024 })
+  {
+    // warm up: epoch context and full dataset items touched by these nonces are created lazily on first use
+    measure_shares_per_sec(hw_threads, workers_count, [&](uint64_t nonce) {
+      crypto::hash h = currency::null_hash;
+      return stratum::check_share(*job, nonce, job->ethash, 1, h);
+    });
+
+    for (size_t threads_count : threads_counts)
+    {
+      // old way: whole check under single work lock
+      std::mutex work_change_lock;
+      double serialized = measure_shares_per_sec(threads_count, workers_count, [&](uint64_t nonce) {
+        std::lock_guard<std::mutex> lk(work_change_lock);
+        crypto::hash h = currency::null_hash;
+        return stratum::check_share(*job, nonce, job->ethash, 1, h);
+      });
+
+      // new way: only job snapshot is taken under the lock
+      std::mutex job_lock;
+      double snapshot = measure_shares_per_sec(threads_count, workers_count, [&](uint64_t nonce) {
+        std::shared_ptr<const stratum::stratum_job> j;
+        {
+          std::lock_guard<std::mutex> lk(job_lock);
+          j = job;
+        }
+        crypto::hash h = currency::null_hash;
+        return stratum::check_share(*j, nonce, j->ethash, 1, h);
+      });
+
+      std::cout << "workers: " << std::setw(5) << workers_count << ", threads: " << std::setw(3) << threads_count
+        << ", shares/sec: serialized " << std::fixed << std::setprecision(1) << serialized << ", snapshot " << snapshot << std::endl;
+    }
+  }
+  return true;
+}
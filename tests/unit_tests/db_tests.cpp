@@ -863,6 +863,98 @@ namespace db_test
     array_accessor_test<db::mdbx_db_backend>();
   }
 
+  //////////////////////////////////////////////////////////////////////////////
+  // read_snapshot_test
+  //////////////////////////////////////////////////////////////////////////////
+  template<typename db_backend_t>
+  void read_snapshot_test()
+  {
+    const std::string array_table_name("array");
+
+    std::shared_ptr<db_backend_t> backend_ptr = std::make_shared<db_backend_t>();
+    epee::shared_recursive_mutex db_lock;
+    db::basic_db_accessor dbb(backend_ptr, db_lock);
+    db::snapshot_aware_shared_membership read_lock(db_lock, dbb);
+
+    db::array_accessor<serializable_string, true> db_array(dbb);
+
+    ASSERT_TRUE(dbb.open("read_snapshot_test"));
+    ASSERT_TRUE(db_array.init(array_table_name));
+
+    ASSERT_TRUE(db_array.begin_transaction());
+    ASSERT_TRUE(db_array.clear());
+    db_array.push_back(serializable_string("A"));
+    db_array.push_back(serializable_string("B"));
+    db_array.commit_transaction();
+
+    ASSERT_FALSE(dbb.is_in_read_snapshot());
+    dbb.begin_read_snapshot();
+    ASSERT_TRUE(dbb.is_in_read_snapshot());
+    {
+      CRITICAL_REGION_LOCAL(read_lock);
+      // fill caches
+      ASSERT_EQ(db_array.size(), 2);
+      ASSERT_EQ(db_array[0]->v, "A");
+
+      // writer commits while this thread holds the lock in the snapshot: it would wait forever if the lock was taken
+      std::atomic<bool> writer_done(false);
+      std::thread writer([&]()
+      {
+        db_array.begin_transaction();
+        db_array.push_back(serializable_string("C"));
+        db_array.set(0, serializable_string("Z"));
+        db_array.commit_transaction();
+        writer_done = true;
+      });
+      writer.join();
+      ASSERT_TRUE(writer_done);
+
+      // nested snapshot keeps the outer one
+      dbb.begin_read_snapshot();
+      ASSERT_EQ(db_array.size(), 2);
+      ASSERT_EQ(db_array[0]->v, "A");
+      ASSERT_EQ(db_array[1]->v, "B");
+      ASSERT_FALSE(db_array.get(2));
+      dbb.end_read_snapshot();
+      ASSERT_TRUE(dbb.is_in_read_snapshot());
+      ASSERT_EQ(db_array[0]->v, "A");
+    }
+    dbb.end_read_snapshot();
+    ASSERT_FALSE(dbb.is_in_read_snapshot());
+
+    dbb.begin_read_snapshot();
+    ASSERT_EQ(db_array.size(), 3);
+    ASSERT_EQ(db_array[0]->v, "Z");
+    ASSERT_EQ(db_array[2]->v, "C");
+    dbb.end_read_snapshot();
+
+    // snapshot can't be started inside other transaction
+    ASSERT_TRUE(db_array.begin_transaction(true));
+    bool r = false;
+    try
+    {
+      dbb.begin_read_snapshot();
+    }
+    catch (...)
+    {
+      r = true;
+    }
+    ASSERT_TRUE(r);
+    db_array.commit_transaction();
+
+    ASSERT_TRUE(dbb.close());
+  }
+
+  TEST(lmdb, read_snapshot_test)
+  {
+    read_snapshot_test<db::lmdb_db_backend>();
+  }
+
+  TEST(mdbx, read_snapshot_test)
+  {
+    read_snapshot_test<db::mdbx_db_backend>();
+  }
+
   //////////////////////////////////////////////////////////////////////////////
   // key_value_test
   //////////////////////////////////////////////////////////////////////////////
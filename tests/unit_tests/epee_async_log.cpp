@@ -0,0 +1,141 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "include_base_utils.h"
+
+namespace
+{
+  struct capture_log_stream : public epee::log_space::ibase_log_stream
+  {
+    capture_log_stream(std::vector<std::string>& lines, std::mutex& lock) : m_lines(lines), m_lock(lock)
+    {}
+    virtual bool out_buffer(const char* buffer, int buffer_len, int log_level, int color, const char* plog_name = NULL)
+    {
+      std::lock_guard<std::mutex> lk(m_lock);
+      m_lines.push_back(std::string(buffer, buffer_len));
+      return true;
+    }
+    virtual int get_type() { return 100; }
+
+    std::vector<std::string>& m_lines;
+    std::mutex& m_lock;
+  };
+}
+
+TEST(epee_async_log, ring_drops_on_overflow)
+{
+  epee::log_space::async_log_ring ring(4);
+  for (size_t i = 0; i != 4; i++)
+    ASSERT_TRUE(ring.push(std::to_string(i), LOG_LEVEL_0, 0, nullptr));
+  ASSERT_FALSE(ring.push("overflow", LOG_LEVEL_0, 0, nullptr));
+  ASSERT_EQ(ring.size(), 4);
+
+  size_t expected = 0;
+  size_t count = ring.pop_all([&](const epee::log_space::async_log_ring::entry& e) {
+    ASSERT_EQ(e.message, std::to_string(expected++));
+  });
+  ASSERT_EQ(count, 4);
+  ASSERT_EQ(ring.size(), 0);
+  ASSERT_TRUE(ring.push("next", LOG_LEVEL_0, 0, nullptr));
+}
+
+TEST(epee_async_log, ring_producer_consumer)
+{
+  const uint64_t count = 20000;
+  epee::log_space::async_log_ring ring(64);
+
+  std::thread producer([&]() {
+    for (uint64_t i = 0; i != count;)
+    {
+      if (ring.push(std::to_string(i), LOG_LEVEL_0, 0, nullptr))
+        i++;
+      else
+        std::this_thread::yield();
+    }
+  });
+
+  uint64_t expected = 0;
+  bool order_ok = true;
+  while (expected != count)
+  {
+    size_t popped = ring.pop_all([&](const epee::log_space::async_log_ring::entry& e) {
+      if (e.message != std::to_string(expected))
+        order_ok = false;
+      expected++;
+    });
+    if (!popped)
+      std::this_thread::yield();
+  }
+  producer.join();
+  ASSERT_TRUE(order_ok);
+}
+
+TEST(epee_async_log, logger_delivers_all_messages_in_order)
+{
+  const size_t threads_count = 4;
+  const size_t messages_per_thread = 1000;
+
+  std::vector<std::string> lines;
+  std::mutex lines_lock;
+  epee::log_space::logger lgr;
+  lgr.add_logger(new capture_log_stream(lines, lines_lock), LOG_LEVEL_4);
+  ASSERT_TRUE(lgr.enable_async_mode(messages_per_thread));
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t != threads_count; t++)
+  {
+    threads.push_back(std::thread([&, t]() {
+      for (size_t i = 0; i != messages_per_thread; i++)
+        lgr.do_log_message(std::to_string(t) + ":" + std::to_string(i), LOG_LEVEL_2, epee::log_space::console_color_default);
+    }));
+  }
+  for (auto& th : threads)
+    th.join();
+  ASSERT_TRUE(lgr.disable_async_mode());
+
+  epee::log_space::async_log_stats st = lgr.get_async_stats();
+  ASSERT_EQ(st.dropped, 0);
+  ASSERT_EQ(st.written, threads_count * messages_per_thread);
+
+  std::vector<size_t> next_expected(threads_count, 0);
+  size_t received = 0;
+  for (const auto& l : lines)
+  {
+    size_t t = 0, i = 0;
+    if (sscanf(l.c_str(), "%zu:%zu", &t, &i) != 2 || t >= threads_count)
+      continue; // not ours (e.g. logger init line)
+    ASSERT_EQ(i, next_expected[t]);
+    next_expected[t]++;
+    received++;
+  }
+  ASSERT_EQ(received, threads_count * messages_per_thread);
+}
+
+TEST(epee_async_log, logger_counts_dropped_messages)
+{
+  std::vector<std::string> lines;
+  std::mutex lines_lock;
+  epee::log_space::logger lgr;
+  lgr.add_logger(new capture_log_stream(lines, lines_lock), LOG_LEVEL_4);
+  ASSERT_TRUE(lgr.enable_async_mode(8));
+
+  // keep the writer away from target, so the ring fills up
+  {
+    std::unique_lock<std::mutex> lk(lines_lock);
+    for (size_t i = 0; i != 100; i++)
+      lgr.do_log_message(std::to_string(i), LOG_LEVEL_2, epee::log_space::console_color_default);
+  }
+  ASSERT_TRUE(lgr.disable_async_mode());
+
+  epee::log_space::async_log_stats st = lgr.get_async_stats();
+  ASSERT_GE(st.dropped, 1);
+  ASSERT_EQ(st.written + st.dropped, 100);
+}
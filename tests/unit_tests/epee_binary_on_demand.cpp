@@ -0,0 +1,351 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include "epee/include/serialization/keyvalue_serialization.h"
+#include "epee/include/storages/portable_storage_template_helper.h"
+
+namespace
+{
+  struct bod_item
+  {
+    std::string name;
+    uint64_t amount;
+    std::vector<uint32_t> indexes;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(name)
+      KV_SERIALIZE(amount)
+      KV_SERIALIZE(indexes)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct bod_inner
+  {
+    int32_t a;
+    bool flag;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(flag)
+      KV_SERIALIZE(a)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  // fields are declared out of name order on purpose
+  struct bod_struct
+  {
+    uint64_t u64;
+    uint32_t u32;
+    uint16_t u16;
+    uint8_t u8;
+    int64_t i64;
+    int32_t i32;
+    int16_t i16;
+    int8_t i8;
+    double d;
+    bool b;
+    std::string str;
+    epee::serialization::storage_entry meta;
+    bod_inner inner;
+    std::list<bod_item> items;
+    std::vector<std::string> strs;
+    std::list<double> doubles;
+    std::vector<bool> bools;
+    std::list<uint64_t> empty_list;
+    std::vector<uint64_t> blob;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(u64)
+      KV_SERIALIZE(u32)
+      KV_SERIALIZE(u16)
+      KV_SERIALIZE(u8)
+      KV_SERIALIZE(i64)
+      KV_SERIALIZE(i32)
+      KV_SERIALIZE(i16)
+      KV_SERIALIZE(i8)
+      KV_SERIALIZE(d)
+      KV_SERIALIZE(b)
+      KV_SERIALIZE(str)
+      KV_SERIALIZE(meta)
+      KV_SERIALIZE(inner)
+      KV_SERIALIZE(items)
+      KV_SERIALIZE(strs)
+      KV_SERIALIZE(doubles)
+      KV_SERIALIZE(bools)
+      KV_SERIALIZE(empty_list)
+      KV_SERIALIZE_CONTAINER_POD_AS_BLOB(blob)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  bod_struct make_bod_struct()
+  {
+    bod_struct s = AUTO_VAL_INIT(s);
+    s.u64 = 18446744073709551615ULL;
+    s.u32 = 4000000000;
+    s.u16 = 65000;
+    s.u8 = 200;
+    s.i64 = -9223372036854775807LL - 1;
+    s.i32 = -2000000000;
+    s.i16 = -32000;
+    s.i8 = -100;
+    s.d = -1.5e300;
+    s.b = true;
+    s.str = std::string("bin\0\x01\xff", 6) + std::string(70, 'x'); // length needs a two byte varint
+    epee::serialization::section meta_sec;
+    meta_sec.m_entries["z"] = epee::serialization::storage_entry(uint64_t(1));
+    meta_sec.m_entries["a"] = epee::serialization::storage_entry(std::string("v"));
+    s.meta = epee::serialization::storage_entry(meta_sec);
+    s.inner.a = -7;
+    s.inner.flag = true;
+    for (uint32_t i = 0; i != 100; ++i)
+    {
+      bod_item it = AUTO_VAL_INIT(it);
+      it.name = "item " + std::to_string(i);
+      it.amount = i * 1000000000000ULL;
+      for (uint32_t j = 0; j != i % 4; ++j)
+        it.indexes.push_back(i * j);
+      s.items.push_back(it);
+    }
+    s.strs = { "x", "", "\\", std::string(20000, 'y') };
+    s.doubles = { 0.5, -0.25 };
+    s.bools = { true, false, true };
+    s.blob = { 1, 2, 3 };
+    return s;
+  }
+
+  template<class t_struct>
+  std::string store_with_portable_storage(const t_struct& s)
+  {
+    epee::serialization::portable_storage ps;
+    s.store(ps);
+    std::string buff;
+    ps.store_to_binary(buff);
+    return buff;
+  }
+
+  template<class t_struct>
+  bool load_with_portable_storage(t_struct& s, const std::string& buff)
+  {
+    epee::serialization::portable_storage ps;
+    return ps.load_from_binary(buff) && s.load(ps);
+  }
+
+  void check_equal(const bod_struct& l, const bod_struct& r)
+  {
+    ASSERT_EQ(l.u64, r.u64);
+    ASSERT_EQ(l.u32, r.u32);
+    ASSERT_EQ(l.u16, r.u16);
+    ASSERT_EQ(l.u8, r.u8);
+    ASSERT_EQ(l.i64, r.i64);
+    ASSERT_EQ(l.i32, r.i32);
+    ASSERT_EQ(l.i16, r.i16);
+    ASSERT_EQ(l.i8, r.i8);
+    ASSERT_EQ(l.d, r.d);
+    ASSERT_EQ(l.b, r.b);
+    ASSERT_EQ(l.str, r.str);
+    ASSERT_TRUE(r.meta.type() == typeid(epee::serialization::section));
+    const epee::serialization::section& meta_sec = boost::get<epee::serialization::section>(r.meta);
+    ASSERT_EQ(meta_sec.m_entries.size(), 2);
+    ASSERT_EQ(boost::get<std::string>(meta_sec.m_entries.at("a")), "v");
+    ASSERT_EQ(boost::get<uint64_t>(meta_sec.m_entries.at("z")), 1);
+    ASSERT_EQ(l.inner.a, r.inner.a);
+    ASSERT_EQ(l.inner.flag, r.inner.flag);
+    ASSERT_EQ(l.items.size(), r.items.size());
+    for (auto li = l.items.begin(), ri = r.items.begin(); li != l.items.end(); ++li, ++ri)
+    {
+      ASSERT_EQ(li->name, ri->name);
+      ASSERT_EQ(li->amount, ri->amount);
+      ASSERT_EQ(li->indexes, ri->indexes);
+    }
+    ASSERT_EQ(l.strs, r.strs);
+    ASSERT_EQ(l.doubles, r.doubles);
+    ASSERT_EQ(l.bools, r.bools);
+    ASSERT_EQ(l.empty_list, r.empty_list);
+    ASSERT_EQ(l.blob, r.blob);
+  }
+
+  // a field stored twice under one name
+  struct bod_duplicated
+  {
+    uint64_t first;
+    std::string second;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE_N(first, "v")
+      KV_SERIALIZE_N(second, "v")
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct bod_narrow
+  {
+    uint32_t u64;
+    int8_t u8;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(u64)
+      KV_SERIALIZE(u8)
+    END_KV_SERIALIZE_MAP()
+  };
+}
+
+TEST(epee_binary_on_demand, writer_gives_same_bytes_as_portable_storage)
+{
+  bod_struct s = make_bod_struct();
+  std::string expected = store_with_portable_storage(s);
+  std::string buff;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(s, buff));
+  ASSERT_EQ(expected, buff);
+
+  bod_struct empty = AUTO_VAL_INIT(empty);
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(empty, buff));
+  ASSERT_EQ(store_with_portable_storage(empty), buff);
+
+  bod_duplicated dup = AUTO_VAL_INIT(dup);
+  dup.first = 5;
+  dup.second = "last";
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(dup, buff));
+  ASSERT_EQ(store_with_portable_storage(dup), buff);
+}
+
+TEST(epee_binary_on_demand, reader_loads_same_as_portable_storage)
+{
+  bod_struct src = make_bod_struct();
+  std::string buff = store_with_portable_storage(src);
+
+  bod_struct from_ps = AUTO_VAL_INIT(from_ps);
+  ASSERT_TRUE(load_with_portable_storage(from_ps, buff));
+  bod_struct from_reader = AUTO_VAL_INIT(from_reader);
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(from_reader, buff));
+  check_equal(src, from_reader);
+  check_equal(from_ps, from_reader);
+
+  // loading over a filled struct
+  bod_struct empty = AUTO_VAL_INIT(empty);
+  buff = store_with_portable_storage(empty);
+  bod_struct l1 = make_bod_struct(), l2 = make_bod_struct();
+  ASSERT_EQ(load_with_portable_storage(l1, buff), epee::serialization::load_t_from_binary(l2, buff));
+  ASSERT_EQ(l1.items.size(), l2.items.size());
+  ASSERT_EQ(l1.strs, l2.strs);
+  ASSERT_EQ(l1.u64, l2.u64);
+}
+
+TEST(epee_binary_on_demand, conversions_like_portable_storage)
+{
+  bod_struct src = AUTO_VAL_INIT(src);
+  src.u64 = 7;
+  src.u8 = 100;
+  std::string buff = store_with_portable_storage(src);
+  bod_narrow n1 = AUTO_VAL_INIT(n1), n2 = AUTO_VAL_INIT(n2);
+  ASSERT_TRUE(load_with_portable_storage(n1, buff));
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(n2, buff));
+  ASSERT_EQ(n1.u64, n2.u64);
+  ASSERT_EQ(n1.u8, n2.u8);
+
+  // out of range conversion fails both ways
+  src.u64 = 1ULL << 40;
+  buff = store_with_portable_storage(src);
+  ASSERT_FALSE(load_with_portable_storage(n1, buff));
+  ASSERT_FALSE(epee::serialization::load_t_from_binary(n2, buff));
+
+  // string to number fails both ways
+  bod_duplicated dup = AUTO_VAL_INIT(dup);
+  dup.second = "abc";
+  buff = store_with_portable_storage(dup);
+  bod_duplicated d1 = AUTO_VAL_INIT(d1), d2 = AUTO_VAL_INIT(d2);
+  ASSERT_FALSE(load_with_portable_storage(d1, buff));
+  ASSERT_FALSE(epee::serialization::load_t_from_binary(d2, buff));
+}
+
+TEST(epee_binary_on_demand, rejects_broken_buffers)
+{
+  bod_struct src = make_bod_struct();
+  std::string buff = store_with_portable_storage(src);
+
+  // truncation is an error
+  for (size_t len = 0; len < buff.size(); len += len < 512 ? 1 : 997)
+  {
+    bod_struct s = AUTO_VAL_INIT(s);
+    ASSERT_FALSE(epee::serialization::load_t_from_binary(s, buff.substr(0, len))) << len;
+  }
+
+  // wrong signature
+  std::string bad = buff;
+  bad[0] ^= 1;
+  bod_struct s = AUTO_VAL_INIT(s);
+  ASSERT_FALSE(epee::serialization::load_t_from_binary(s, bad));
+
+  // array element count beyond the buffer
+  epee::serialization::portable_storage ps;
+  epee::serialization::harray ha = ps.insert_first_value("a", uint64_t(1), nullptr);
+  ps.insert_next_value(ha, uint64_t(2));
+  ps.store_to_binary(bad);
+  // header, entries count, name length, name, type, elements count
+  size_t count_pos = 9 + 1 + 1 + 1 + 1;
+  ASSERT_EQ(static_cast<uint8_t>(bad[count_pos]), 2 << 2);
+  bad[count_pos] = static_cast<char>(60 << 2);
+  epee::serialization::binary_on_demand_reader reader;
+  ASSERT_FALSE(reader.load_from_binary(bad));
+
+  // too deep nesting
+  epee::serialization::portable_storage deep;
+  epee::serialization::hsection h = nullptr;
+  for (size_t i = 0; i != 200; ++i)
+    h = deep.open_section("s", h, true);
+  deep.store_to_binary(bad);
+  ASSERT_FALSE(reader.load_from_binary(bad));
+}
+
+TEST(epee_binary_on_demand, reader_api)
+{
+  epee::serialization::portable_storage ps;
+  ps.set_value("str", std::string("value"), nullptr);
+  epee::serialization::harray ha = ps.insert_first_value("nums", uint16_t(1), nullptr);
+  ps.insert_next_value(ha, uint16_t(2));
+  epee::serialization::hsection hchild = nullptr;
+  ha = ps.insert_first_section("secs", hchild, nullptr);
+  ps.set_value("k", int64_t(-1), hchild);
+  ps.insert_next_section(ha, hchild);
+  ps.set_value("k", int64_t(-2), hchild);
+  std::string buff;
+  ASSERT_TRUE(ps.store_to_binary(buff));
+
+  epee::serialization::binary_on_demand_reader reader;
+  ASSERT_TRUE(reader.load_from_binary(buff));
+
+  uint64_t n1 = 0, n2 = 0, n3 = 0;
+  epee::serialization::binary_on_demand_reader::harray hna = reader.get_first_value("nums", n1, nullptr);
+  ASSERT_TRUE(hna != nullptr);
+  ASSERT_TRUE(reader.get_next_value(hna, n2));
+  ASSERT_FALSE(reader.get_next_value(hna, n3));
+  ASSERT_EQ(n1, 1);
+  ASSERT_EQ(n2, 2);
+
+  epee::serialization::binary_on_demand_reader::hsection hsec = nullptr;
+  epee::serialization::binary_on_demand_reader::harray hsa = reader.get_first_section("secs", hsec, nullptr);
+  ASSERT_TRUE(hsa != nullptr);
+  int64_t k = 0;
+  ASSERT_TRUE(reader.get_value("k", k, hsec));
+  ASSERT_EQ(k, -1);
+  ASSERT_TRUE(reader.get_next_section(hsa, hsec));
+  ASSERT_TRUE(reader.get_value("k", k, hsec));
+  ASSERT_EQ(k, -2);
+  ASSERT_FALSE(reader.get_next_section(hsa, hsec));
+
+  ASSERT_TRUE(reader.open_section("str", nullptr) == nullptr);
+  ASSERT_TRUE(reader.open_section("missing", nullptr) == nullptr);
+  ASSERT_TRUE(reader.get_first_section("nums", hsec, nullptr) == nullptr);
+  std::string str;
+  ASSERT_TRUE(reader.get_value("str", str, nullptr));
+  ASSERT_EQ(str, "value");
+  ASSERT_FALSE(reader.get_value("missing", str, nullptr));
+
+  epee::serialization::storage_entry se;
+  ASSERT_TRUE(reader.get_value("secs", se, nullptr));
+  ASSERT_TRUE(se.type() == typeid(epee::serialization::array_entry));
+}
@@ -0,0 +1,280 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <string>
+#include <vector>
+
+#include "include_base_utils.h"
+#include "net/http_protocol_handler.h"
+#include "net/net_utils_base.h"
+
+namespace
+{
+  typedef epee::net_utils::connection_context_base test_http_context;
+
+  struct test_http_handler : public epee::net_utils::http::i_http_server_handler<test_http_context>
+  {
+    virtual bool handle_http_request(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response, test_http_context& context)
+    {
+      m_requests.push_back(query_info);
+      response.m_body = m_response_body.size() ? m_response_body : query_info.m_URI + "|" + query_info.m_body;
+      return true;
+    }
+
+    std::vector<epee::net_utils::http::http_request_info> m_requests;
+    std::string m_response_body;
+  };
+
+  struct test_http_response
+  {
+    std::string head;
+    std::string body;
+  };
+
+  class test_http_connection : public epee::net_utils::i_service_endpoint
+  {
+  public:
+    test_http_connection(size_t compress_min_body_size = 0)
+      : m_handler(this, init_config(compress_min_body_size), m_context)
+    {
+    }
+
+    bool recv(const std::string& data)
+    {
+      return m_handler.handle_recv(data.data(), data.size());
+    }
+
+    // responses sent so far, split by Content-Length
+    std::vector<test_http_response> responses() const
+    {
+      std::vector<test_http_response> result;
+      size_t pos = 0;
+      while (pos < m_sent.size())
+      {
+        size_t head_end = m_sent.find("\r\n\r\n", pos);
+        if (std::string::npos == head_end)
+          break;
+        test_http_response r;
+        r.head = m_sent.substr(pos, head_end + 4 - pos);
+        size_t len = std::stoul(epee::net_utils::http::get_value_from_fields_list("Content-Length", parse_fields(r.head)));
+        r.body = m_sent.substr(head_end + 4, len);
+        result.push_back(r);
+        pos = head_end + 4 + len;
+      }
+      return result;
+    }
+
+    static epee::net_utils::http::fields_list parse_fields(const std::string& head)
+    {
+      epee::net_utils::http::fields_list fields;
+      size_t pos = head.find("\r\n") + 2;
+      for (size_t end = head.find("\r\n", pos); end != std::string::npos && end != pos; pos = end + 2, end = head.find("\r\n", pos))
+      {
+        size_t colon = head.find(':', pos);
+        fields.push_back(std::make_pair(head.substr(pos, colon - pos), epee::string_tools::trim(head.substr(colon + 1, end - colon - 1))));
+      }
+      return fields;
+    }
+
+    test_http_handler m_commands;
+    std::string m_sent;
+    size_t m_send_count = 0;
+
+  private:
+    epee::net_utils::http::custum_handler_config<test_http_context>& init_config(size_t compress_min_body_size)
+    {
+      m_config.m_phandler = &m_commands;
+      m_config.m_compress_min_body_size = compress_min_body_size;
+      return m_config;
+    }
+
+    virtual bool do_send(const void* ptr, size_t cb) { m_sent.append(static_cast<const char*>(ptr), cb); ++m_send_count; return true; }
+    virtual bool close() { return true; }
+    virtual bool call_run_once_service_io() { return true; }
+    virtual bool request_callback() { return true; }
+    virtual boost::asio::io_service& get_io_service() { return m_io_service; }
+    virtual bool add_ref() { return true; }
+    virtual bool release() { return true; }
+
+    boost::asio::io_service m_io_service;
+    test_http_context m_context;
+    epee::net_utils::http::custum_handler_config<test_http_context> m_config;
+    epee::net_utils::http::http_custom_handler<test_http_context> m_handler;
+  };
+
+  std::string inflate_any(const std::string& packed)
+  {
+    z_stream zstream = {0};
+    if (Z_OK != inflateInit2(&zstream, MAX_WBITS + 32)) // zlib or gzip header, auto detected
+      return std::string();
+    std::string result(1024 * 1024, '\0');
+    zstream.next_in = (Bytef*)packed.data();
+    zstream.avail_in = (uInt)packed.size();
+    zstream.next_out = (Bytef*)&result[0];
+    zstream.avail_out = (uInt)result.size();
+    int ret = inflate(&zstream, Z_FINISH);
+    inflateEnd(&zstream);
+    if (Z_STREAM_END != ret)
+      return std::string();
+    result.resize(result.size() - zstream.avail_out);
+    return result;
+  }
+
+  const std::string pipelined_requests =
+    "GET /getheight HTTP/1.1\r\nHost: localhost\r\n\r\n"
+    "POST /json_rpc HTTP/1.1\r\nContent-Length: 5\r\ncontent-type:application/json\r\n\r\n{\"a\"}"
+    "GET /last HTTP/1.1\r\n\r\n";
+}
+
+TEST(epee_http_protocol_handler, pipelined_requests)
+{
+  // whole batch at once and byte by byte
+  for (size_t chunk : { pipelined_requests.size(), size_t(1) })
+  {
+    test_http_connection conn;
+    for (size_t pos = 0; pos < pipelined_requests.size(); pos += chunk)
+      ASSERT_TRUE(conn.recv(pipelined_requests.substr(pos, chunk)));
+
+    std::vector<test_http_response> responses = conn.responses();
+    ASSERT_EQ(3, responses.size());
+    ASSERT_EQ("/getheight|", responses[0].body);
+    ASSERT_EQ("/json_rpc|{\"a\"}", responses[1].body);
+    ASSERT_EQ("/last|", responses[2].body);
+    ASSERT_EQ(3, conn.m_send_count); // head and body go in one send
+    for (const test_http_response& r : responses)
+      ASSERT_EQ(0, r.head.find("HTTP/1.1 200 OK\r\n"));
+
+    ASSERT_EQ(3, conn.m_commands.m_requests.size());
+    const epee::net_utils::http::http_request_info& post = conn.m_commands.m_requests[1];
+    ASSERT_EQ(epee::net_utils::http::http_method_post, post.m_http_method);
+    ASSERT_EQ("POST", post.m_http_method_str);
+    ASSERT_EQ("POST /json_rpc HTTP/1.1\r\n", post.m_full_request_str);
+    ASSERT_EQ("application/json", post.m_header_info.m_content_type);
+    ASSERT_EQ("localhost", conn.m_commands.m_requests[0].m_header_info.m_host);
+  }
+}
+
+TEST(epee_http_protocol_handler, keep_alive)
+{
+  struct
+  {
+    const char* request;
+    bool keep_alive;
+    const char* connection_field;
+  } cases[] = {
+    { "GET / HTTP/1.1\r\n\r\n", true, "" },
+    { "GET / HTTP/1.1\r\nConnection: Close\r\n\r\n", false, "close" },
+    { "GET / HTTP/1.1\r\nConnection: TE, close\r\n\r\n", false, "close" },
+    { "GET / HTTP/1.0\r\n\r\n", false, "close" },
+    { "GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n", true, "keep-alive" },
+  };
+  for (const auto& c : cases)
+  {
+    test_http_connection conn;
+    ASSERT_EQ(c.keep_alive, conn.recv(c.request)) << c.request;
+    std::vector<test_http_response> responses = conn.responses();
+    ASSERT_EQ(1, responses.size());
+    ASSERT_EQ(c.connection_field, epee::net_utils::http::get_value_from_fields_list("Connection", test_http_connection::parse_fields(responses[0].head))) << c.request;
+  }
+
+  // requests pipelined after "close" are not served
+  test_http_connection conn;
+  ASSERT_FALSE(conn.recv("GET /1 HTTP/1.1\r\nConnection: close\r\n\r\nGET /2 HTTP/1.1\r\n\r\n"));
+  ASSERT_EQ(1, conn.responses().size());
+}
+
+TEST(epee_http_protocol_handler, header_parsing)
+{
+  test_http_connection conn;
+  ASSERT_TRUE(conn.recv("\r\nget /x?a=1 http/1.1\r\nX-Folded: one\r\n  two\r\nno colon line\r\nCOOKIE:c=1  \r\nX-Empty:\r\nContent-Length:  2 \r\n\r\nab"));
+  ASSERT_EQ(1, conn.m_commands.m_requests.size());
+  const epee::net_utils::http::http_request_info& req = conn.m_commands.m_requests[0];
+  ASSERT_EQ(epee::net_utils::http::http_method_get, req.m_http_method);
+  ASSERT_EQ("/x?a=1", req.m_URI);
+  ASSERT_EQ("/x", req.m_uri_content.m_path);
+  ASSERT_EQ(1, req.m_http_ver_hi);
+  ASSERT_EQ(1, req.m_http_ver_lo);
+  ASSERT_EQ("c=1", req.m_header_info.m_cookie);
+  ASSERT_EQ("ab", req.m_body);
+  ASSERT_EQ("one two", epee::net_utils::http::get_value_from_fields_list("x-folded", req.m_header_info.m_etc_fields));
+  ASSERT_EQ(2, req.m_header_info.m_etc_fields.size());
+
+  const char* bad_requests[] = {
+    "FETCH / HTTP/1.1\r\n\r\n",
+    "GET / HTTP/1\r\n\r\n",
+    "GET / HTTP/1.1 x\r\n\r\n",
+    "GET  HTTP/1.1\r\n\r\n",
+    "GET /\r\n\r\n",
+    "POST / HTTP/1.1\r\nContent-Length: 1a\r\n\r\n",
+    "POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n",
+    "POST / HTTP/1.1\r\nContent-Length: 99999999999999999999\r\n\r\n",
+  };
+  for (const char* request : bad_requests)
+  {
+    test_http_connection bad_conn;
+    ASSERT_FALSE(bad_conn.recv(request)) << request;
+    ASSERT_TRUE(bad_conn.m_commands.m_requests.empty()) << request;
+  }
+}
+
+TEST(epee_http_protocol_handler, response_compression)
+{
+  std::string big_body;
+  for (size_t i = 0; big_body.size() < 20000; ++i)
+    big_body += "{\"height\": " + std::to_string(i) + ", \"hash\": \"00ff\"},";
+
+  struct
+  {
+    const char* accept_encoding;
+    const char* content_encoding;
+  } cases[] = {
+    { nullptr, "" },
+    { "gzip", "gzip" },
+    { "deflate, gzip;q=1.0", "gzip" },
+    { "gzip;q=0, deflate", "deflate" },
+    { "gzip; q=0.00, deflate;q=0", "" },
+    { "br", "" },
+    { "*", "gzip" },
+    { "identity, *;q=0.5", "gzip" },
+  };
+  for (const auto& c : cases)
+  {
+    test_http_connection conn(4096);
+    conn.m_commands.m_response_body = big_body;
+    std::string request = "GET / HTTP/1.1\r\n";
+    if (c.accept_encoding)
+      request += std::string("Accept-Encoding: ") + c.accept_encoding + "\r\n";
+    ASSERT_TRUE(conn.recv(request + "\r\n"));
+
+    std::vector<test_http_response> responses = conn.responses();
+    ASSERT_EQ(1, responses.size());
+    epee::net_utils::http::fields_list fields = test_http_connection::parse_fields(responses[0].head);
+    std::string encoding = epee::net_utils::http::get_value_from_fields_list("Content-Encoding", fields);
+    ASSERT_EQ(c.content_encoding, encoding) << request;
+    ASSERT_EQ("Accept-Encoding", epee::net_utils::http::get_value_from_fields_list("Vary", fields));
+    if (encoding.empty())
+    {
+      ASSERT_EQ(big_body, responses[0].body);
+    }
+    else
+    {
+      ASSERT_LT(responses[0].body.size(), big_body.size() / 4);
+      ASSERT_EQ(encoding == "gzip", responses[0].body.compare(0, 2, "\x1f\x8b") == 0);
+      ASSERT_EQ(big_body, inflate_any(responses[0].body));
+    }
+  }
+
+  // small bodies and disabled compression are sent as is
+  for (size_t min_size : { size_t(0), big_body.size() + 1 })
+  {
+    test_http_connection conn(min_size);
+    conn.m_commands.m_response_body = big_body;
+    ASSERT_TRUE(conn.recv("GET / HTTP/1.1\r\nAccept-Encoding: gzip\r\n\r\n"));
+    ASSERT_EQ(1, conn.responses().size());
+    ASSERT_EQ(big_body, conn.responses()[0].body);
+    ASSERT_EQ(std::string::npos, conn.responses()[0].head.find("Content-Encoding"));
+  }
+}
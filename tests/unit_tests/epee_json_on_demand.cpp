@@ -0,0 +1,227 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include "epee/include/serialization/keyvalue_serialization.h"
+#include "epee/include/storages/portable_storage_template_helper.h"
+
+namespace
+{
+  struct jod_item
+  {
+    std::string name;
+    uint64_t amount;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(amount)
+      KV_SERIALIZE(name)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct jod_inner
+  {
+    int32_t a;
+    bool flag;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(a)
+      KV_SERIALIZE(flag)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  // fields are declared in alphabetical order, so json_stream_writer output matches portable_storage's
+  struct jod_struct
+  {
+    double d;
+    epee::serialization::storage_entry id;
+    jod_inner inner;
+    std::vector<jod_item> items;
+    int64_t neg;
+    std::list<uint64_t> nums;
+    std::string str;
+    std::vector<std::string> strs;
+    uint64_t u64;
+    uint8_t u8;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(d)
+      KV_SERIALIZE(id)
+      KV_SERIALIZE(inner)
+      KV_SERIALIZE(items)
+      KV_SERIALIZE(neg)
+      KV_SERIALIZE(nums)
+      KV_SERIALIZE(str)
+      KV_SERIALIZE(strs)
+      KV_SERIALIZE(u64)
+      KV_SERIALIZE(u8)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  jod_struct make_jod_struct()
+  {
+    jod_struct s = AUTO_VAL_INIT(s);
+    s.d = 1.25;
+    s.id = epee::serialization::storage_entry(std::string("abc"));
+    s.inner.a = -7;
+    s.inner.flag = true;
+    s.items.push_back(jod_item{ "first \"quoted\"\n", 1 });
+    s.items.push_back(jod_item{ "second", 18446744073709551615ULL });
+    s.neg = -9223372036854775807LL - 1;
+    s.nums = { 0, 5, 1000000000000ULL };
+    s.str = std::string("bin\0\x01\xff/", 7);
+    s.strs = { "x", "", "\\" };
+    s.u8 = 200;
+    s.u64 = 12345678901234ULL;
+    return s;
+  }
+
+  void check_equal(const jod_struct& l, const jod_struct& r)
+  {
+    ASSERT_EQ(l.d, r.d);
+    ASSERT_EQ(boost::get<std::string>(l.id), boost::get<std::string>(r.id));
+    ASSERT_EQ(l.inner.a, r.inner.a);
+    ASSERT_EQ(l.inner.flag, r.inner.flag);
+    ASSERT_EQ(l.items.size(), r.items.size());
+    for (size_t i = 0; i != l.items.size(); ++i)
+    {
+      ASSERT_EQ(l.items[i].name, r.items[i].name);
+      ASSERT_EQ(l.items[i].amount, r.items[i].amount);
+    }
+    ASSERT_EQ(l.neg, r.neg);
+    ASSERT_EQ(l.nums, r.nums);
+    ASSERT_EQ(l.str, r.str);
+    ASSERT_EQ(l.strs, r.strs);
+    ASSERT_EQ(l.u8, r.u8);
+    ASSERT_EQ(l.u64, r.u64);
+  }
+}
+
+TEST(epee_json_on_demand, loads_same_as_portable_storage)
+{
+  jod_struct src = make_jod_struct();
+  std::string json = epee::serialization::store_t_to_json(src);
+
+  jod_struct from_ps = AUTO_VAL_INIT(from_ps);
+  ASSERT_TRUE(epee::serialization::load_t_from_json(from_ps, json));
+  jod_struct from_reader = AUTO_VAL_INIT(from_reader);
+  ASSERT_TRUE(epee::serialization::load_t_from_json_on_demand(from_reader, json));
+
+  check_equal(src, from_reader);
+  check_equal(from_ps, from_reader);
+}
+
+TEST(epee_json_on_demand, stream_writer_output)
+{
+  jod_struct src = make_jod_struct();
+  for (size_t indent = 0; indent != 3; ++indent)
+  {
+    for (auto eol : { epee::serialization::eol_crlf, epee::serialization::eol_lf, epee::serialization::eol_space })
+    {
+      std::string expected;
+      ASSERT_TRUE(epee::serialization::store_t_to_json(src, expected, indent, eol));
+      std::string json;
+      ASSERT_TRUE(epee::serialization::store_t_to_json_stream(src, json, indent, eol));
+      ASSERT_EQ(expected, json);
+    }
+  }
+
+  // empty struct and struct with empty containers
+  jod_inner empty_inner = AUTO_VAL_INIT(empty_inner);
+  jod_struct empty = AUTO_VAL_INIT(empty);
+  std::string json;
+  ASSERT_TRUE(epee::serialization::store_t_to_json_stream(empty, json));
+  ASSERT_EQ(epee::serialization::store_t_to_json(empty), json);
+  ASSERT_TRUE(epee::serialization::store_t_to_json_stream(empty_inner, json));
+  ASSERT_EQ(epee::serialization::store_t_to_json(empty_inner), json);
+}
+
+TEST(epee_json_on_demand, lenient_input_like_portable_storage)
+{
+  // missing sub-object gives defaults, null is absent value, keywords are case-insensitive, trailing data is ignored
+  jod_struct s = AUTO_VAL_INIT(s);
+  s.u64 = 77;
+  ASSERT_TRUE(epee::serialization::load_t_from_json_on_demand(s, R"( { "u64" : null, "neg": -3, "d": 1.5e3, "strs": [], "items":[{"name":"a"},{}], "inner": { "flag": TRUE } } garbage)"));
+  ASSERT_EQ(s.u64, 77);
+  ASSERT_EQ(s.neg, -3);
+  ASSERT_EQ(s.d, 1500.0);
+  ASSERT_TRUE(s.strs.empty());
+  ASSERT_EQ(s.items.size(), 2);
+  ASSERT_EQ(s.items[0].name, "a");
+  ASSERT_TRUE(s.inner.flag);
+
+  jod_inner in = AUTO_VAL_INIT(in);
+  ASSERT_TRUE(epee::serialization::load_t_from_json_on_demand(in, ""));
+  ASSERT_TRUE(epee::serialization::load_t_from_json_on_demand(in, "{}"));
+
+  // escaped key
+  ASSERT_TRUE(epee::serialization::load_t_from_json_on_demand(in, R"({"\u0061": 5})"));
+  ASSERT_EQ(in.a, 5);
+}
+
+TEST(epee_json_on_demand, rejects_what_portable_storage_rejects)
+{
+  const char* bad_inputs[] = {
+    R"({"a": 1 "flag": true})",           // missing comma
+    R"({"a": yes})",                      // unknown keyword
+    R"({"a": [[1]]})",                    // array of arrays is not loadable
+    R"([1, 2])",                          // not an object
+    R"({"a": "1"})",                      // string to int
+    R"({"a": 1.5})",                      // double to int
+    R"({"a": 4294967296})",               // int32 overflow
+    R"({"a": -1, "flag": 1})",            // int to bool
+    R"({"a": {}})",                       // object to int
+    R"({"a": 1, "flag": true)",           // truncated
+  };
+  for (const char* json : bad_inputs)
+  {
+    jod_inner in = AUTO_VAL_INIT(in);
+    ASSERT_FALSE(epee::serialization::load_t_from_json_on_demand(in, json)) << json;
+  }
+
+  jod_struct s = AUTO_VAL_INIT(s);
+  ASSERT_FALSE(epee::serialization::load_t_from_json_on_demand(s, R"({"u64": -1})"));
+  ASSERT_FALSE(epee::serialization::load_t_from_json_on_demand(s, R"({"u64": 18446744073709551616})"));
+  ASSERT_FALSE(epee::serialization::load_t_from_json_on_demand(s, R"({"nums": [1, -1]})"));
+
+  // KV_SERIALIZE ignores missing and mistyped arrays of objects
+  ASSERT_TRUE(epee::serialization::load_t_from_json_on_demand(s, R"({"items": [1, 2]})"));
+  ASSERT_TRUE(s.items.empty());
+}
+
+TEST(epee_json_on_demand, reader_api)
+{
+  epee::serialization::json_on_demand_reader reader;
+  ASSERT_TRUE(reader.load_from_json(R"({"id": 12, "method": "eth_submitWork", "params": ["0x1", "0x2"], "obj": {"k": -1}})"));
+
+  epee::serialization::storage_entry id;
+  ASSERT_TRUE(reader.get_value("id", id, nullptr));
+  ASSERT_EQ(boost::get<uint64_t>(id), 12);
+
+  std::string method, p1, p2, p3;
+  ASSERT_TRUE(reader.get_value("method", method, nullptr));
+  ASSERT_EQ(method, "eth_submitWork");
+  epee::serialization::json_on_demand_reader::harray ha = reader.get_first_value("params", p1, nullptr);
+  ASSERT_TRUE(ha != nullptr);
+  ASSERT_TRUE(reader.get_next_value(ha, p2));
+  ASSERT_FALSE(reader.get_next_value(ha, p3));
+  ASSERT_EQ(p1, "0x1");
+  ASSERT_EQ(p2, "0x2");
+
+  ASSERT_TRUE(reader.open_section("params", nullptr) == nullptr);
+  ASSERT_TRUE(reader.open_section("missing", nullptr) == nullptr);
+  epee::serialization::json_on_demand_reader::hsection hobj = reader.open_section("obj", nullptr);
+  ASSERT_TRUE(hobj != nullptr);
+  int64_t k = 0;
+  ASSERT_TRUE(reader.get_value("k", k, hobj));
+  ASSERT_EQ(k, -1);
+
+  epee::serialization::storage_entry obj;
+  ASSERT_TRUE(reader.get_value("obj", obj, nullptr));
+  ASSERT_TRUE(obj.type() == typeid(epee::serialization::section));
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <limits>
+
+#include "include_base_utils.h"
+#include "math_helper.h"
+
+using epee::math_helper::latency_histogram;
+
+TEST(latency_histogram, bucket_bounds_are_consistent)
+{
+  for (uint64_t v = 0; v != 100000; v++)
+  {
+    size_t idx = latency_histogram::get_bucket_index(v);
+    ASSERT_LT(idx, static_cast<size_t>(latency_histogram::buckets_count));
+    ASSERT_GE(latency_histogram::get_bucket_upper_bound(idx), v);
+    if (idx)
+      ASSERT_LT(latency_histogram::get_bucket_upper_bound(idx - 1), v);
+  }
+  ASSERT_EQ(latency_histogram::get_bucket_index(std::numeric_limits<uint64_t>::max()), latency_histogram::buckets_count - 1);
+}
+
+TEST(latency_histogram, percentiles)
+{
+  latency_histogram h;
+  ASSERT_EQ(h.get_percentile(0.99), 0);
+
+  for (uint64_t v = 1; v <= 1000; v++)
+    h.push(v);
+  h.push(1000000);
+
+  ASSERT_EQ(h.get_count(), 1001);
+  ASSERT_EQ(h.get_max(), 1000000);
+  ASSERT_EQ(h.get_percentile(1.0), 1000000);
+
+  // 3 bits of mantissa -> relative error is within 12.5%
+  uint64_t p50 = h.get_percentile(0.5);
+  ASSERT_GE(p50, 500);
+  ASSERT_LE(p50, 500 + 500 / 8);
+  uint64_t p99 = h.get_percentile(0.99);
+  ASSERT_GE(p99, 990);
+  ASSERT_LE(p99, 990 + 990 / 8);
+
+  h.reset();
+  ASSERT_EQ(h.get_count(), 0);
+  ASSERT_EQ(h.get_max(), 0);
+}
+
+TEST(latency_histogram, average_with_histogram_keeps_both)
+{
+  epee::math_helper::average_with_histogram<uint64_t, 5> a;
+  for (uint64_t v = 1; v <= 10; v++)
+    a.push(v);
+
+  ASSERT_EQ(a.get_last_val(), 10);
+  ASSERT_EQ(a.get_avg(), 8);
+  ASSERT_EQ(a.get_histogram().get_count(), 10);
+  ASSERT_EQ(a.get_histogram().get_max(), 10);
+}
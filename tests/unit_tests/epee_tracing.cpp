@@ -0,0 +1,71 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "include_base_utils.h"
+#include "profile_tools.h"
+
+namespace
+{
+  size_t count_substr(const std::string& s, const std::string& what)
+  {
+    size_t count = 0;
+    for (size_t pos = s.find(what); pos != std::string::npos; pos = s.find(what, pos + what.size()))
+      count++;
+    return count;
+  }
+
+  void traced_work(size_t n)
+  {
+    for (size_t i = 0; i != n; i++)
+    {
+      TRACE_SPAN("tracing_test::outer");
+      {
+        TRACE_SPAN("tracing_test::inner");
+      }
+    }
+  }
+}
+
+TEST(epee_tracing, spans_recorded_only_when_enabled)
+{
+  epee::profile_tools::tracer& t = epee::profile_tools::tracer::instance();
+  t.disable();
+  traced_work(10);
+
+  t.enable();
+  std::thread th1(traced_work, 5);
+  std::thread th2(traced_work, 7);
+  th1.join();
+  th2.join();
+  t.disable();
+  {
+    TRACE_SPAN("tracing_test::disabled");
+  }
+
+  std::stringstream ss;
+  t.dump_chrome_trace(3600, ss);
+  std::string json = ss.str();
+
+  ASSERT_EQ(count_substr(json, "\"tracing_test::outer\""), 12);
+  ASSERT_EQ(count_substr(json, "\"tracing_test::inner\""), 12);
+  ASSERT_EQ(count_substr(json, "\"tracing_test::disabled\""), 0);
+  ASSERT_EQ(json.find("{\"traceEvents\":["), 0);
+}
+
+TEST(epee_tracing, ring_keeps_last_events)
+{
+  epee::profile_tools::trace_thread_buffer buff(4, 0);
+  for (uint64_t i = 0; i != 10; i++)
+    buff.add("x", i, 1);
+
+  std::vector<uint64_t> starts;
+  buff.enumerate([&](const epee::profile_tools::trace_event& e) { starts.push_back(e.start_us); });
+  ASSERT_EQ(starts, std::vector<uint64_t>({ 6, 7, 8, 9 }));
+}
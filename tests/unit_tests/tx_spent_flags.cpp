@@ -0,0 +1,49 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include "currency_core/blockchain_storage_basic.h"
+#include "serialization/serialization.h"
+
+TEST(tx_spent_flags, set_and_check)
+{
+  currency::tx_spent_flags sf = AUTO_VAL_INIT(sf);
+  ASSERT_TRUE(sf.empty());
+  ASSERT_FALSE(sf.is_spent(0));
+  ASSERT_FALSE(sf.is_spent(1000));
+
+  sf.set(3, true);
+  sf.set(64, true);
+  sf.set(130, true);
+  ASSERT_EQ(sf.bits.size(), 3);
+  ASSERT_TRUE(sf.is_spent(3));
+  ASSERT_TRUE(sf.is_spent(64));
+  ASSERT_TRUE(sf.is_spent(130));
+  ASSERT_FALSE(sf.is_spent(2));
+  ASSERT_FALSE(sf.is_spent(65));
+  ASSERT_FALSE(sf.is_spent(129));
+
+  // unspending the highest outputs shrinks the bitmap
+  sf.set(130, false);
+  ASSERT_EQ(sf.bits.size(), 2);
+  sf.set(64, false);
+  ASSERT_EQ(sf.bits.size(), 1);
+  sf.set(3, false);
+  ASSERT_TRUE(sf.empty());
+}
+
+TEST(tx_spent_flags, serialization_is_compact)
+{
+  currency::tx_spent_flags sf = AUTO_VAL_INIT(sf);
+  sf.set(5, true);
+  std::string blob;
+  ASSERT_TRUE(t_serializable_object_to_blob(sf, blob));
+  ASSERT_LE(blob.size(), 1 + sizeof(uint64_t));
+
+  currency::tx_spent_flags sf2 = AUTO_VAL_INIT(sf2);
+  ASSERT_TRUE(t_unserializable_object_from_blob(sf2, blob));
+  ASSERT_TRUE(sf2.is_spent(5));
+  ASSERT_FALSE(sf2.is_spent(4));
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2023-2024 Beezy Network
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <vector>
+
+#include "wallet/wallet_refresh_scheduler.h"
+
+namespace
+{
+  struct counting_core_proxy : public tools::i_core_proxy
+  {
+    counting_core_proxy() :calls(0), current_height(100) {}
+
+    virtual bool call_COMMAND_RPC_GET_BLOCKS_DIRECT(const currency::COMMAND_RPC_GET_BLOCKS_DIRECT::request& rqt, currency::COMMAND_RPC_GET_BLOCKS_DIRECT::response& rsp) override
+    {
+      calls++;
+      std::this_thread::sleep_for(std::chrono::milliseconds(200)); // let other wallets pile up
+      rsp.status = API_RETURN_CODE_OK;
+      rsp.start_height = rqt.minimum_height;
+      rsp.current_height = current_height;
+      rsp.blocks.resize(3);
+      return true;
+    }
+
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> current_height;
+  };
+
+  currency::COMMAND_RPC_GET_BLOCKS_DIRECT::request make_request(uint64_t top_id_seed)
+  {
+    currency::COMMAND_RPC_GET_BLOCKS_DIRECT::request req = AUTO_VAL_INIT(req);
+    crypto::hash h = currency::null_hash;
+    *reinterpret_cast<uint64_t*>(&h) = top_id_seed;
+    req.block_ids.push_back(h);
+    req.block_ids.push_back(currency::null_hash);
+    return req;
+  }
+}
+
+TEST(wallet_refresh_scheduler, same_requests_fetched_once)
+{
+  std::shared_ptr<counting_core_proxy> proxy(new counting_core_proxy());
+  std::atomic<uint64_t> daemon_height(100);
+  tools::wallet_refresh_scheduler scheduler(proxy, &daemon_height);
+
+  const size_t wallets_count = 16;
+  std::vector<std::thread> wallets;
+  std::atomic<size_t> ok_count(0);
+  for (size_t i = 0; i != wallets_count; i++)
+  {
+    wallets.emplace_back([&]() {
+      currency::COMMAND_RPC_GET_BLOCKS_DIRECT::response rsp = AUTO_VAL_INIT(rsp);
+      if (scheduler.call_COMMAND_RPC_GET_BLOCKS_DIRECT(make_request(1), rsp) && rsp.blocks.size() == 3)
+        ok_count++;
+    });
+  }
+  for (auto& th : wallets)
+    th.join();
+
+  ASSERT_EQ(ok_count, wallets_count);
+  ASSERT_EQ(proxy->calls, 1);
+  ASSERT_EQ(scheduler.get_stats().served_from_shared, wallets_count - 1);
+
+  // wallet at different height gets its own batch
+  currency::COMMAND_RPC_GET_BLOCKS_DIRECT::response rsp = AUTO_VAL_INIT(rsp);
+  ASSERT_TRUE(scheduler.call_COMMAND_RPC_GET_BLOCKS_DIRECT(make_request(2), rsp));
+  ASSERT_EQ(proxy->calls, 2);
+}
+
+TEST(wallet_refresh_scheduler, outdated_batch_is_refetched)
+{
+  std::shared_ptr<counting_core_proxy> proxy(new counting_core_proxy());
+  std::atomic<uint64_t> daemon_height(100);
+  tools::wallet_refresh_scheduler scheduler(proxy, &daemon_height);
+
+  currency::COMMAND_RPC_GET_BLOCKS_DIRECT::response rsp = AUTO_VAL_INIT(rsp);
+  ASSERT_TRUE(scheduler.call_COMMAND_RPC_GET_BLOCKS_DIRECT(make_request(1), rsp));
+  ASSERT_TRUE(scheduler.call_COMMAND_RPC_GET_BLOCKS_DIRECT(make_request(1), rsp));
+  ASSERT_EQ(proxy->calls, 1);
+
+  // daemon got a new block, cached batch doesn't cover it anymore
+  daemon_height = 101;
+  proxy->current_height = 101;
+  ASSERT_TRUE(scheduler.call_COMMAND_RPC_GET_BLOCKS_DIRECT(make_request(1), rsp));
+  ASSERT_EQ(proxy->calls, 2);
+  ASSERT_EQ(rsp.current_height, 101);
+}